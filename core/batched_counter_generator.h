@@ -13,8 +13,10 @@
 
 #include <cstdint>
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <vector>
 
 namespace ycsbc {
 
@@ -33,6 +35,22 @@ class BatchedCounterGenerator : public Generator<uint64_t> {
   uint64_t Last() { return start_ + num_completed_batches_ * batch_size_; }
   uint64_t Set(uint64_t start) { assert(false); }
 
+  ///
+  /// The generator of the numbers of the keys inserted into table i of a
+  /// multi-table workload, from start on. It is created on first use and
+  /// shared by all the workloads of this generator.
+  ///
+  BatchedCounterGenerator *TableGenerator(size_t i, uint64_t start) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tables_.size() <= i) {
+      tables_.resize(i + 1);
+    }
+    if (!tables_[i]) {
+      tables_[i].reset(new BatchedCounterGenerator(start, batch_size_));
+    }
+    return tables_[i].get();
+  }
+
   void MarkCompleted(uint64_t batch_start) {
     std::lock_guard<std::mutex> lock(mutex_);
     uint64_t batch_num = (batch_start - start_) / batch_size_;
@@ -51,6 +69,7 @@ class BatchedCounterGenerator : public Generator<uint64_t> {
   std::mutex mutex_;
   std::atomic<uint64_t> num_completed_batches_;
   std::set<uint64_t> outstanding_;
+  std::vector<std::unique_ptr<BatchedCounterGenerator>> tables_;
 };
 
 } // ycsbc
@@ -25,6 +25,14 @@ class Client {
   
   virtual bool DoInsert();
   virtual bool DoTransaction();
+
+  ///
+  /// Performs n inserts or n operations, issuing the reads, updates and
+  /// inserts among them in batches. Returns the number of successful
+  /// operations.
+  ///
+  virtual uint64_t DoInsertBatch(uint64_t n);
+  virtual uint64_t DoTransactionBatch(uint64_t n);
   
   virtual ~Client() { }
   
@@ -35,11 +43,41 @@ class Client {
   virtual int TransactionScan();
   virtual int TransactionUpdate();
   virtual int TransactionInsert();
+  virtual int TransactionDelete();
+  virtual int TransactionMultiKey();
+
+  ///
+  /// Operations of one kind on one table, waiting to be issued together.
+  ///
+  struct Batch {
+    std::string table;
+    std::vector<std::string> keys;
+    std::vector<std::vector<std::string>> fields; /// Of reads; empty for all fields
+    std::vector<bool> all_fields;
+    std::vector<std::vector<DB::KVPair>> values;  /// Written, or read
+    std::vector<int> statuses;
+
+    void Clear() {
+      keys.clear();
+      fields.clear();
+      all_fields.clear();
+      values.clear();
+    }
+  };
+
+  /// Adds an operation to a batch, issuing the batch first if it is for
+  /// another table. Returns the index of the operation in the batch.
+  size_t AddToBatch(Batch &batch, Operation op, const std::string &table, uint64_t &oks);
+  /// Issues the operations of a batch and returns how many succeeded
+  uint64_t IssueBatch(Batch &batch, Operation op);
   
   DB &db_;
   CoreWorkload &workload_;
   std::string key;
   std::vector<DB::KVPair> pairs;
+  Batch reads_;
+  Batch updates_;
+  Batch inserts_;
 };
 
 inline bool Client::DoInsert() {
@@ -66,6 +104,12 @@ inline bool Client::DoTransaction() {
     case READMODIFYWRITE:
       status = TransactionReadModifyWrite();
       break;
+    case DELETE:
+      status = TransactionDelete();
+      break;
+    case TRANSACTION:
+      status = TransactionMultiKey();
+      break;
     default:
       throw utils::Exception("Operation request is not recognized!");
   }
@@ -73,13 +117,122 @@ inline bool Client::DoTransaction() {
   return (status == DB::kOK);
 }
 
+inline uint64_t Client::DoInsertBatch(uint64_t n) {
+  uint64_t oks = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    // The key decides the table when loading several tables
+    workload_.NextSequenceKey(key);
+    size_t j = AddToBatch(inserts_, INSERT, workload_.NextTable(), oks);
+    inserts_.keys[j] = key;
+    workload_.BuildValues(inserts_.values[j]);
+  }
+  return oks + IssueBatch(inserts_, INSERT);
+}
+
+inline uint64_t Client::DoTransactionBatch(uint64_t n) {
+  uint64_t oks = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    size_t j;
+    switch (workload_.NextOperation()) {
+      case READ:
+        j = AddToBatch(reads_, READ, workload_.NextTable(), oks);
+        reads_.keys[j] = workload_.NextTransactionKey();
+        reads_.all_fields[j] = workload_.read_all_fields();
+        if (!workload_.read_all_fields()) {
+          reads_.fields[j].push_back(workload_.NextFieldName());
+        }
+        break;
+      case UPDATE:
+        j = AddToBatch(updates_, UPDATE, workload_.NextTable(), oks);
+        updates_.keys[j] = workload_.NextTransactionKey();
+        if (workload_.write_all_fields()) {
+          workload_.BuildValues(updates_.values[j]);
+        } else {
+          workload_.BuildUpdate(updates_.values[j]);
+        }
+        break;
+      case INSERT:
+        j = AddToBatch(inserts_, INSERT, workload_.NextTable(), oks);
+        workload_.NextSequenceKey(key);
+        inserts_.keys[j] = key;
+        workload_.BuildValues(inserts_.values[j]);
+        break;
+      case SCAN:
+        oks += (TransactionScan() == DB::kOK);
+        break;
+      case READMODIFYWRITE:
+        oks += (TransactionReadModifyWrite() == DB::kOK);
+        break;
+      case DELETE:
+        oks += (TransactionDelete() == DB::kOK);
+        break;
+      case TRANSACTION:
+        oks += (TransactionMultiKey() == DB::kOK);
+        break;
+      default:
+        throw utils::Exception("Operation request is not recognized!");
+    }
+  }
+  oks += IssueBatch(reads_, READ);
+  oks += IssueBatch(updates_, UPDATE);
+  oks += IssueBatch(inserts_, INSERT);
+  return oks;
+}
+
+inline size_t Client::AddToBatch(Batch &batch, Operation op, const std::string &table,
+                                 uint64_t &oks) {
+  if (!batch.keys.empty() && batch.table != table) {
+    oks += IssueBatch(batch, op);
+  }
+  batch.table = table;
+  batch.keys.emplace_back();
+  batch.values.emplace_back();
+  if (op == READ) {
+    batch.fields.emplace_back();
+    batch.all_fields.push_back(true);
+  }
+  return batch.keys.size() - 1;
+}
+
+inline uint64_t Client::IssueBatch(Batch &batch, Operation op) {
+  if (batch.keys.empty()) {
+    return 0;
+  }
+  switch (op) {
+    case READ: {
+      std::vector<const std::vector<std::string> *> fields(batch.keys.size());
+      for (size_t i = 0; i < fields.size(); ++i) {
+        fields[i] = batch.all_fields[i] ? NULL : &batch.fields[i];
+      }
+      batch.values.clear();
+      db_.BatchRead(batch.table, batch.keys, fields, batch.values, batch.statuses);
+      break;
+    }
+    case UPDATE:
+      db_.BatchUpdate(batch.table, batch.keys, batch.values, batch.statuses);
+      break;
+    case INSERT:
+      db_.BatchInsert(batch.table, batch.keys, batch.values, batch.statuses);
+      break;
+    default:
+      throw utils::Exception("Operation cannot be batched!");
+  }
+  uint64_t oks = 0;
+  for (size_t i = 0; i < batch.keys.size(); ++i) {
+    assert(batch.statuses[i] >= 0);
+    oks += (batch.statuses[i] == DB::kOK);
+  }
+  batch.Clear();
+  return oks;
+}
+
 inline int Client::TransactionRead() {
   const std::string &table = workload_.NextTable();
   const std::string &key = workload_.NextTransactionKey();
   std::vector<DB::KVPair> result;
   if (!workload_.read_all_fields()) {
     std::vector<std::string> fields;
-    fields.push_back("field" + workload_.NextFieldName());
+    fields.push_back(workload_.NextFieldName());
     return db_.Read(table, key, &fields, result);
   } else {
     return db_.Read(table, key, NULL, result);
@@ -93,7 +246,7 @@ inline int Client::TransactionReadModifyWrite() {
 
   if (!workload_.read_all_fields()) {
     std::vector<std::string> fields;
-    fields.push_back("field" + workload_.NextFieldName());
+    fields.push_back(workload_.NextFieldName());
     db_.Read(table, key, &fields, result);
   } else {
     db_.Read(table, key, NULL, result);
@@ -115,7 +268,7 @@ inline int Client::TransactionScan() {
   std::vector<std::vector<DB::KVPair>> result;
   if (!workload_.read_all_fields()) {
     std::vector<std::string> fields;
-    fields.push_back("field" + workload_.NextFieldName());
+    fields.push_back(workload_.NextFieldName());
     return db_.Scan(table, key, len, &fields, result);
   } else {
     return db_.Scan(table, key, len, NULL, result);
@@ -142,6 +295,36 @@ inline int Client::TransactionInsert() {
   return db_.Insert(table, key, values);
 } 
 
+inline int Client::TransactionDelete() {
+  const std::string &table = workload_.NextTable();
+  const std::string &key = workload_.NextTransactionKey();
+  return db_.Delete(table, key);
+}
+
+inline int Client::TransactionMultiKey() {
+  const std::string &table = workload_.NextTable();
+  std::vector<std::string> keys(workload_.transaction_keys());
+  for (std::string &key : keys) {
+    key = workload_.NextTransactionKey();
+  }
+  std::vector<std::vector<DB::KVPair>> values(workload_.transaction_updates());
+  for (std::vector<DB::KVPair> &update : values) {
+    if (workload_.write_all_fields()) {
+      workload_.BuildValues(update);
+    } else {
+      workload_.BuildUpdate(update);
+    }
+  }
+  std::vector<std::vector<DB::KVPair>> results;
+  if (!workload_.read_all_fields()) {
+    std::vector<std::string> fields;
+    fields.push_back(workload_.NextFieldName());
+    return db_.ExecuteTransaction(table, keys, &fields, results, values);
+  } else {
+    return db_.ExecuteTransaction(table, keys, NULL, results, values);
+  }
+}
+
 } // ycsbc
 
 #endif // YCSB_C_CLIENT_H_
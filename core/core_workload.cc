@@ -10,9 +10,11 @@
 #include "zipfian_generator.h"
 #include "scrambled_zipfian_generator.h"
 #include "skewed_latest_generator.h"
+#include "hotspot_generator.h"
 #include "const_generator.h"
 #include "core_workload.h"
 
+#include <sstream>
 #include <string>
 
 using ycsbc::CoreWorkload;
@@ -21,6 +23,9 @@ using std::string;
 const string CoreWorkload::TABLENAME_PROPERTY = "table";
 const string CoreWorkload::TABLENAME_DEFAULT = "usertable";
 
+const string CoreWorkload::TABLES_PROPERTY = "tables";
+const string CoreWorkload::TABLE_PROPORTION_PROPERTY = "proportion";
+
 const string CoreWorkload::FIELD_COUNT_PROPERTY = "fieldcount";
 const string CoreWorkload::FIELD_COUNT_DEFAULT = "10";
 
@@ -53,13 +58,41 @@ const string CoreWorkload::READMODIFYWRITE_PROPORTION_PROPERTY =
     "readmodifywriteproportion";
 const string CoreWorkload::READMODIFYWRITE_PROPORTION_DEFAULT = "0.0";
 
+const string CoreWorkload::TRANSACTION_PROPORTION_PROPERTY = "transactionproportion";
+const string CoreWorkload::TRANSACTION_PROPORTION_DEFAULT = "0.0";
+
+const string CoreWorkload::TRANSACTION_KEYS_PROPERTY = "transactionkeys";
+const string CoreWorkload::TRANSACTION_KEYS_DEFAULT = "4";
+
+const string CoreWorkload::TRANSACTION_UPDATES_PROPERTY = "transactionupdates";
+const string CoreWorkload::TRANSACTION_UPDATES_DEFAULT = "2";
+
 const string CoreWorkload::REQUEST_DISTRIBUTION_PROPERTY =
     "requestdistribution";
 const string CoreWorkload::REQUEST_DISTRIBUTION_DEFAULT = "uniform";
 
+const string CoreWorkload::ZIPFIAN_CONSTANT_PROPERTY = "zipfianconstant";
+const string CoreWorkload::ZIPFIAN_CONSTANT_DEFAULT = "0.99";
+
+const string CoreWorkload::ZIPFIAN_VERIFY_PROPERTY = "zipfianverify";
+const string CoreWorkload::ZIPFIAN_VERIFY_DEFAULT = "0";
+
+const string CoreWorkload::HOTSPOT_DATA_FRACTION_PROPERTY = "hotspotdatafraction";
+const string CoreWorkload::HOTSPOT_DATA_FRACTION_DEFAULT = "0.2";
+
+const string CoreWorkload::HOTSPOT_OPN_FRACTION_PROPERTY = "hotspotopnfraction";
+const string CoreWorkload::HOTSPOT_OPN_FRACTION_DEFAULT = "0.8";
+
+const string CoreWorkload::HOTSPOT_SHIFT_OPS_PROPERTY = "hotspotshiftops";
+const string CoreWorkload::HOTSPOT_SHIFT_INTERVAL_PROPERTY = "hotspotshiftinterval";
+const string CoreWorkload::HOTSPOT_SHIFT_FRACTION_PROPERTY = "hotspotshiftfraction";
+
 const string CoreWorkload::ZERO_PADDING_PROPERTY = "zeropadding";
 const string CoreWorkload::ZERO_PADDING_DEFAULT = "20";
 
+const string CoreWorkload::KEY_PREFIX_PROPERTY = "keyprefix";
+const string CoreWorkload::KEY_PREFIX_DEFAULT = "user";
+
 const string CoreWorkload::MAX_SCAN_LENGTH_PROPERTY = "maxscanlength";
 const string CoreWorkload::MAX_SCAN_LENGTH_DEFAULT = "1000";
 
@@ -73,11 +106,52 @@ const string CoreWorkload::INSERT_ORDER_DEFAULT = "hashed";
 const string CoreWorkload::INSERT_START_PROPERTY = "insertstart";
 const string CoreWorkload::INSERT_START_DEFAULT = "0";
 
+const string CoreWorkload::TRACE_FILE_PROPERTY = "tracefile";
+
+const string CoreWorkload::TARGET_PROPERTY = "target";
+const string CoreWorkload::TARGET_DEFAULT = "0";
+
+const string CoreWorkload::BATCH_SIZE_PROPERTY = "batchsize";
+const string CoreWorkload::BATCH_SIZE_DEFAULT = "1";
+
+const string ycsbc::WorkloadSchedule::SCHEDULE_PROPERTY = "schedule";
+
 const string CoreWorkload::RECORD_COUNT_PROPERTY = "recordcount";
 const string CoreWorkload::OPERATION_COUNT_PROPERTY = "operationcount";
 
+double CoreWorkload::ZipfianConstant(const utils::Properties &p) {
+  double theta = std::stod(p.GetProperty(ZIPFIAN_CONSTANT_PROPERTY, ZIPFIAN_CONSTANT_DEFAULT));
+  if (theta <= 0 || theta >= 1) {
+    throw utils::Exception("Zipfian constant must be between 0 and 1: " + std::to_string(theta));
+  }
+  return theta;
+}
+
+uint64_t CoreWorkload::BatchSize(const utils::Properties &p) {
+  long long batch_size = std::stoll(p.GetProperty(BATCH_SIZE_PROPERTY, BATCH_SIZE_DEFAULT));
+  if (batch_size < 1) {
+    throw utils::Exception("Batch size must be at least 1: " + std::to_string(batch_size));
+  }
+  return batch_size;
+}
+
+uint64_t CoreWorkload::ZipfianKeySpace(const utils::Properties &p, uint64_t record_count) {
+  // If the number of keys changes, we don't want to change popular keys.
+  // So we construct the scrambled zipfian generator with a keyspace
+  // that is larger than what exists at the beginning of the test.
+  // If the generator picks a key that is not inserted yet, we just ignore it
+  // and pick another key.
+  int op_count = std::stoi(p.GetProperty(OPERATION_COUNT_PROPERTY));
+  double insert_proportion = std::stod(p.GetProperty(INSERT_PROPORTION_PROPERTY,
+                                                     INSERT_PROPORTION_DEFAULT));
+  int new_keys = (int)(op_count * insert_proportion * 2); // a fudge factor
+  return record_count + new_keys;
+}
+
 void CoreWorkload::InitLoadWorkload(const utils::Properties &p, unsigned int nthreads, unsigned int this_thread, BatchedCounterGenerator *key_generator) {
+  ClearTables();
   table_name_ = p.GetProperty(TABLENAME_PROPERTY,TABLENAME_DEFAULT);
+  key_prefix_ = p.GetProperty(KEY_PREFIX_PROPERTY, KEY_PREFIX_DEFAULT);
   
   field_count_ = std::stoi(p.GetProperty(FIELD_COUNT_PROPERTY,
                                          FIELD_COUNT_DEFAULT));
@@ -97,15 +171,182 @@ void CoreWorkload::InitLoadWorkload(const utils::Properties &p, unsigned int nth
 
   insert_key_sequence_.Set(record_count_);
 
+  batch_size_ = BatchSize(p);
+
+  // Batches of keys are claimed on the first insert, so that threads
+  // which never insert do not hold back key_generator->Last()
   key_generator_ = key_generator;
-  key_batch_start_ = key_generator_->Next();
-  key_generator_batch_.Set(key_batch_start_);
-  batch_remaining_ = key_generator_->BatchSize();
+  key_batch_.Reset();
+
+  if (!p.GetProperty(TABLES_PROPERTY).empty()) {
+    InitTables(p);
+  }
 }
 
+std::vector<std::string> CoreWorkload::TableNames(const utils::Properties &p) {
+  std::vector<std::string> names;
+  std::stringstream list(p.GetProperty(TABLES_PROPERTY));
+  std::string name;
+  while (std::getline(list, name, ',')) {
+    names.push_back(utils::Trim(name));
+  }
+  return names;
+}
+
+void CoreWorkload::InitTables(const utils::Properties &p) {
+  std::vector<std::string> names = TableNames(p);
+
+  // Tables that do not set their record count share what is left
+  uint64_t unset = 0, left = record_count_;
+  for (const std::string &name : names) {
+    std::string count = p.GetProperty(TablePrefix(name) + RECORD_COUNT_PROPERTY);
+    if (count.empty()) {
+      unset++;
+    } else if (std::stoull(count) <= left) {
+      left -= std::stoull(count);
+    } else {
+      throw utils::Exception("Table record counts exceed " + RECORD_COUNT_PROPERTY);
+    }
+  }
+  if (unset == 0 && left > 0) {
+    throw utils::Exception("Table record counts do not add up to " + RECORD_COUNT_PROPERTY);
+  }
 
-void CoreWorkload::InitRunWorkload(const utils::Properties &p, unsigned int nthreads, unsigned int this_thread) {
+  uint64_t key_base = 0;
+  for (const std::string &name : names) {
+    utils::Properties tp = p.Overlay(TablePrefix(name));
+    Table *table = new Table;
+    table->name = name;
+    table->key_base = key_base;
+    table->inserts = NULL;
+    table->insert_batch.Reset();
+    if (p.GetProperty(TablePrefix(name) + RECORD_COUNT_PROPERTY).empty()) {
+      table->record_count = left / unset--;
+      left -= table->record_count;
+    } else {
+      table->record_count = std::stoull(tp.GetProperty(RECORD_COUNT_PROPERTY));
+    }
+    table->field_count = std::stoi(tp.GetProperty(FIELD_COUNT_PROPERTY, FIELD_COUNT_DEFAULT));
+    table->field_len_generator = GetFieldLenGenerator(tp);
+    table->field_chooser = new UniformGenerator(generator_, 0, table->field_count - 1);
+    tables_.push_back(table);
+    key_base += table->record_count;
+  }
+
+  // From now on, the generators of the current table are used
+  delete field_len_generator_;
+  delete field_chooser_;
+  SwitchTable(0);
+}
+
+void CoreWorkload::SwitchTable(size_t i) {
+  table_ = tables_[i];
+  field_count_ = table_->field_count;
+  field_len_generator_ = table_->field_len_generator;
+  field_chooser_ = table_->field_chooser;
+  if (i < segments_.size()) {
+    SwitchSegment(i);
+  }
+}
+
+void CoreWorkload::ClearTables() {
+  if (tables_.empty()) {
+    return;
+  }
+  for (Table *table : tables_) {
+    delete table->field_len_generator;
+    delete table->field_chooser;
+    delete table;
+  }
+  tables_.clear();
+  delete table_chooser_;
+  table_ = NULL;
+  table_chooser_ = NULL;
+  field_len_generator_ = NULL;
+  field_chooser_ = NULL;
+}
+
+
+void CoreWorkload::InitRunWorkload(const utils::Properties &p, unsigned int nthreads, unsigned int this_thread,
+                                   TraceReader *trace, WorkloadSchedule *schedule) {
   generator_.seed(this_thread * 3423452437 + 8349344563457);
+  table_name_ = p.GetProperty(TABLENAME_PROPERTY, TABLENAME_DEFAULT);
+
+  if (!p.GetProperty(TRACE_FILE_PROPERTY).empty() && !trace) {
+    throw utils::Exception("Trace replay requested but no trace was opened");
+  }
+  trace_ = trace;
+  trace_pos_ = trace_end_ = trace_record_ = NULL;
+
+  batch_size_ = BatchSize(p);
+
+  transaction_keys_ = std::stoul(p.GetProperty(TRANSACTION_KEYS_PROPERTY,
+                                               TRANSACTION_KEYS_DEFAULT));
+  transaction_updates_ = std::stoul(p.GetProperty(TRANSACTION_UPDATES_PROPERTY,
+                                                  TRANSACTION_UPDATES_DEFAULT));
+  if (transaction_keys_ < 1 || transaction_updates_ > transaction_keys_) {
+    throw utils::Exception("Transactions must read at least one key and update at most "
+                           "the keys they read");
+  }
+
+  ClearSegments();
+  schedule_ = schedule;
+  segment_ops_ = 0;
+  if (!tables_.empty()) {
+    InitRunTables(p, nthreads);
+    return;
+  }
+  if (schedule_) {
+    for (size_t i = 0; i < schedule_->NumSegments(); ++i) {
+      segments_.push_back(BuildSegment(schedule_->SegmentProperties(i), nthreads));
+    }
+  } else {
+    segments_.push_back(BuildSegment(p, nthreads));
+  }
+  SwitchSegment(0);
+
+  if (field_chooser_) delete field_chooser_;
+  field_chooser_ = new UniformGenerator(generator_, 0, field_count_ - 1);
+}
+
+void CoreWorkload::InitRunTables(const utils::Properties &p, unsigned int nthreads) {
+  if (trace_ || schedule_) {
+    throw utils::Exception("Traces and schedules cannot be used with multiple tables");
+  }
+  std::vector<std::string> names = TableNames(p);
+  bool same = names.size() == tables_.size();
+  for (size_t i = 0; same && i < names.size(); ++i) {
+    same = names[i] == tables_[i]->name;
+  }
+  if (!same) {
+    throw utils::Exception("Run workloads must have the tables of the Load workload");
+  }
+
+  // Each table gets the segment of the same index, built for its key range
+  uint64_t record_count = record_count_;
+  delete table_chooser_;
+  table_chooser_ = new DiscreteGenerator<size_t>(generator_);
+  for (size_t i = 0; i < tables_.size(); ++i) {
+    utils::Properties tp = p.Overlay(TablePrefix(tables_[i]->name));
+    if (tp.GetProperty(REQUEST_DISTRIBUTION_PROPERTY, REQUEST_DISTRIBUTION_DEFAULT) == "latest") {
+      throw utils::Exception("The latest distribution cannot be used with multiple tables");
+    }
+    record_count_ = tables_[i]->record_count;
+    if (!tables_[i]->inserts) {
+      tables_[i]->inserts = key_generator_->TableGenerator(i, record_count_);
+      tables_[i]->insert_base = kTableInsertBase * (i + 1) - record_count_;
+    }
+    segments_.push_back(BuildSegment(tp, nthreads));
+    table_chooser_->AddValue(i, std::stod(tp.GetProperty(TABLE_PROPORTION_PROPERTY,
+                                                         std::to_string(record_count_))));
+  }
+  record_count_ = record_count;
+  SwitchTable(0);
+}
+
+CoreWorkload::RunSegment *CoreWorkload::BuildSegment(const utils::Properties &p,
+                                                     unsigned int nthreads) {
+  RunSegment *segment = new RunSegment(generator_);
 
   double read_proportion = std::stod(p.GetProperty(READ_PROPORTION_PROPERTY,
                                                    READ_PROPORTION_DEFAULT));
@@ -117,6 +358,8 @@ void CoreWorkload::InitRunWorkload(const utils::Properties &p, unsigned int nthr
                                                    SCAN_PROPORTION_DEFAULT));
   double readmodifywrite_proportion = std::stod(p.GetProperty(
       READMODIFYWRITE_PROPORTION_PROPERTY, READMODIFYWRITE_PROPORTION_DEFAULT));
+  double transaction_proportion = std::stod(p.GetProperty(TRANSACTION_PROPORTION_PROPERTY,
+                                                          TRANSACTION_PROPORTION_DEFAULT));
   
   std::string request_dist = p.GetProperty(REQUEST_DISTRIBUTION_PROPERTY,
                                            REQUEST_DISTRIBUTION_DEFAULT);
@@ -125,59 +368,121 @@ void CoreWorkload::InitRunWorkload(const utils::Properties &p, unsigned int nthr
   std::string scan_len_dist = p.GetProperty(SCAN_LENGTH_DISTRIBUTION_PROPERTY,
                                             SCAN_LENGTH_DISTRIBUTION_DEFAULT);
 
-  read_all_fields_ = utils::StrToBool(p.GetProperty(READ_ALL_FIELDS_PROPERTY,
-                                                    READ_ALL_FIELDS_DEFAULT));
-  write_all_fields_ = utils::StrToBool(p.GetProperty(WRITE_ALL_FIELDS_PROPERTY,
-                                                     WRITE_ALL_FIELDS_DEFAULT));
+  segment->read_all_fields = utils::StrToBool(p.GetProperty(READ_ALL_FIELDS_PROPERTY,
+                                                            READ_ALL_FIELDS_DEFAULT));
+  segment->write_all_fields = utils::StrToBool(p.GetProperty(WRITE_ALL_FIELDS_PROPERTY,
+                                                             WRITE_ALL_FIELDS_DEFAULT));
+
+  double target = std::stod(p.GetProperty(TARGET_PROPERTY, TARGET_DEFAULT));
+  segment->op_interval_ns = target > 0 ? (uint64_t)(1e9 * nthreads / target) : 0;
   
   if (read_proportion > 0) {
-    op_chooser_.AddValue(READ, read_proportion);
+    segment->op_chooser.AddValue(READ, read_proportion);
   }
   if (update_proportion > 0) {
-    op_chooser_.AddValue(UPDATE, update_proportion);
+    segment->op_chooser.AddValue(UPDATE, update_proportion);
   }
   if (insert_proportion > 0) {
-    op_chooser_.AddValue(INSERT, insert_proportion);
+    segment->op_chooser.AddValue(INSERT, insert_proportion);
   }
   if (scan_proportion > 0) {
-    op_chooser_.AddValue(SCAN, scan_proportion);
+    segment->op_chooser.AddValue(SCAN, scan_proportion);
   }
   if (readmodifywrite_proportion > 0) {
-    op_chooser_.AddValue(READMODIFYWRITE, readmodifywrite_proportion);
+    segment->op_chooser.AddValue(READMODIFYWRITE, readmodifywrite_proportion);
+  }
+  if (transaction_proportion > 0) {
+    segment->op_chooser.AddValue(TRANSACTION, transaction_proportion);
   }
   
   if (request_dist == "uniform") {
-    key_chooser_ = new UniformGenerator(generator_, 0, record_count_ - 1);
+    segment->key_chooser = new UniformGenerator(generator_, 0, record_count_ - 1);
     
   } else if (request_dist == "zipfian") {
-    // If the number of keys changes, we don't want to change popular keys.
-    // So we construct the scrambled zipfian generator with a keyspace
-    // that is larger than what exists at the beginning of the test.
-    // If the generator picks a key that is not inserted yet, we just ignore it
-    // and pick another key.
-    int op_count = std::stoi(p.GetProperty(OPERATION_COUNT_PROPERTY));
-    int new_keys = (int)(op_count * insert_proportion * 2); // a fudge factor
-    key_chooser_ = new ScrambledZipfianGenerator(generator_, record_count_ + new_keys);
+    segment->key_chooser = new ScrambledZipfianGenerator(generator_,
+                                                         ZipfianKeySpace(p, record_count_),
+                                                         ZipfianConstant(p));
     
   } else if (request_dist == "latest") {
-    key_chooser_ = new SkewedLatestGenerator(generator_, *key_generator_);
+    segment->key_chooser = new SkewedLatestGenerator(generator_, *key_generator_,
+                                                     ZipfianConstant(p));
     
+  } else if (request_dist == "hotspot" || request_dist == "shifting_hotspot") {
+    std::string data_fraction = p.GetProperty(HOTSPOT_DATA_FRACTION_PROPERTY,
+                                              HOTSPOT_DATA_FRACTION_DEFAULT);
+    double hot_data_fraction = std::stod(data_fraction);
+    double hot_opn_fraction = std::stod(p.GetProperty(HOTSPOT_OPN_FRACTION_PROPERTY,
+                                                      HOTSPOT_OPN_FRACTION_DEFAULT));
+    if (request_dist == "hotspot") {
+      segment->key_chooser = new HotspotGenerator(generator_, 0, record_count_ - 1,
+                                                  hot_data_fraction, hot_opn_fraction);
+    } else {
+      double shift_fraction = std::stod(p.GetProperty(HOTSPOT_SHIFT_FRACTION_PROPERTY,
+                                                      data_fraction));
+      // Each thread shifts after its share of the operations
+      uint64_t shift_ops = std::stoull(p.GetProperty(HOTSPOT_SHIFT_OPS_PROPERTY, "0"));
+      shift_ops = shift_ops ? std::max<uint64_t>(shift_ops / nthreads, 1) : 0;
+      double shift_interval = std::stod(p.GetProperty(HOTSPOT_SHIFT_INTERVAL_PROPERTY, "0"));
+      if (shift_ops == 0 && shift_interval <= 0) {
+        throw utils::Exception("shifting_hotspot needs " + HOTSPOT_SHIFT_OPS_PROPERTY +
+                               " or " + HOTSPOT_SHIFT_INTERVAL_PROPERTY);
+      }
+      segment->shifting_hotspot = new ShiftingHotspotGenerator(generator_, 0, record_count_ - 1,
+                                                               hot_data_fraction, hot_opn_fraction,
+                                                               shift_fraction, shift_ops,
+                                                               shift_interval);
+      segment->key_chooser = segment->shifting_hotspot;
+    }
+
   } else {
     throw utils::Exception("Unknown request distribution: " + request_dist);
   }
   
-  field_chooser_ = new UniformGenerator(generator_, 0, field_count_ - 1);
-  
   if (scan_len_dist == "uniform") {
-    scan_len_chooser_ = new UniformGenerator(generator_, 1, max_scan_len);
+    segment->scan_len_chooser = new UniformGenerator(generator_, 1, max_scan_len);
   } else if (scan_len_dist == "zipfian") {
-    scan_len_chooser_ = new ZipfianGenerator(generator_, 1, max_scan_len);
+    segment->scan_len_chooser = new ZipfianGenerator(generator_, 1, max_scan_len,
+                                                     ZipfianConstant(p));
   } else {
     throw utils::Exception("Distribution not allowed for scan length: " +
         scan_len_dist);
   }
 
-  //batch_size_ = 1;
+  return segment;
+}
+
+void CoreWorkload::SwitchSegment(size_t i) {
+  RunSegment *segment = segments_[i];
+  segment_ = i;
+  op_chooser_ = &segment->op_chooser;
+  key_chooser_ = segment->key_chooser;
+  scan_len_chooser_ = segment->scan_len_chooser;
+  read_all_fields_ = segment->read_all_fields;
+  write_all_fields_ = segment->write_all_fields;
+  op_interval_ns_ = segment->op_interval_ns;
+}
+
+void CoreWorkload::StartRun(std::chrono::steady_clock::time_point start) {
+  // Later segments of a schedule are restarted as they are entered
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    StartSegment(i, start);
+  }
+}
+
+void CoreWorkload::StartSegment(size_t i, std::chrono::steady_clock::time_point start) {
+  if (segments_[i]->shifting_hotspot) {
+    segments_[i]->shifting_hotspot->Start(start);
+  }
+}
+
+void CoreWorkload::ClearSegments() {
+  for (RunSegment *segment : segments_) {
+    delete segment;
+  }
+  segments_.clear();
+  op_chooser_ = NULL;
+  key_chooser_ = NULL;
+  scan_len_chooser_ = NULL;
 }
 
 ycsbc::Generator<uint64_t> *CoreWorkload::GetFieldLenGenerator(
@@ -191,7 +496,7 @@ ycsbc::Generator<uint64_t> *CoreWorkload::GetFieldLenGenerator(
   } else if(field_len_dist == "uniform") {
     return new UniformGenerator(generator_, 1, field_len);
   } else if(field_len_dist == "zipfian") {
-    return new ZipfianGenerator(generator_, 1, field_len);
+    return new ZipfianGenerator(generator_, 1, field_len, ZipfianConstant(p));
   } else {
     throw utils::Exception("Unknown field length distribution: " +
         field_len_dist);
@@ -200,6 +505,15 @@ ycsbc::Generator<uint64_t> *CoreWorkload::GetFieldLenGenerator(
 
 void CoreWorkload::BuildValues(std::vector<ycsbc::DB::KVPair> &values) {
   values.clear();
+  if (trace_record_ && TraceReader::Record(trace_record_)->value_size) {
+    // Replayed writes carry a single value of the traced size
+    ycsbc::DB::KVPair pair;
+    pair.first.append("field0");
+    pair.second.append(TraceReader::Record(trace_record_)->value_size,
+                       uniform_letter_dist_(generator_));
+    values.push_back(pair);
+    return;
+  }
   for (int i = 0; i < field_count_; ++i) {
     ycsbc::DB::KVPair pair;
     pair.first.append("field").append(std::to_string(i));
@@ -218,6 +532,11 @@ void CoreWorkload::InitPairs(std::vector<ycsbc::DB::KVPair> &values) {
 }
 
 void CoreWorkload::UpdateValues(std::vector<ycsbc::DB::KVPair> &values) {
+  if (!tables_.empty()) {
+    // Tables differ in record size
+    BuildValues(values);
+    return;
+  }
   assert(values.size() == (unsigned int)field_count_);
   for (int i = 0; i < field_count_; ++i) {
     values[i].second[0] = uniform_letter_dist_(generator_);
@@ -225,6 +544,10 @@ void CoreWorkload::UpdateValues(std::vector<ycsbc::DB::KVPair> &values) {
 }
 
 void CoreWorkload::BuildUpdate(std::vector<ycsbc::DB::KVPair> &update) {
+  if (trace_record_ && TraceReader::Record(trace_record_)->value_size) {
+    BuildValues(update);
+    return;
+  }
   ycsbc::DB::KVPair pair;
   pair.first.append(NextFieldName());
   pair.second.append(field_len_generator_->Next(), uniform_letter_dist_(generator_));
@@ -9,6 +9,7 @@
 #ifndef YCSB_C_CORE_WORKLOAD_H_
 #define YCSB_C_CORE_WORKLOAD_H_
 
+#include <chrono>
 #include <vector>
 #include <string>
 #include "db.h"
@@ -17,6 +18,9 @@
 #include "discrete_generator.h"
 #include "counter_generator.h"
 #include "batched_counter_generator.h"
+#include "hotspot_generator.h"
+#include "trace.h"
+#include "workload_schedule.h"
 #include "utils.h"
 
 namespace ycsbc {
@@ -26,7 +30,9 @@ enum Operation {
   READ,
   UPDATE,
   SCAN,
-  READMODIFYWRITE
+  READMODIFYWRITE,
+  DELETE,
+  TRANSACTION
 };
 
 class CoreWorkload {
@@ -36,6 +42,22 @@ class CoreWorkload {
   ///
   static const std::string TABLENAME_PROPERTY;
   static const std::string TABLENAME_DEFAULT;
+
+  ///
+  /// The name of the property for a comma-separated list of tables, each
+  /// a key space of its own, instead of the single "table". The workload
+  /// properties of a table may be overridden with "table.<name>." ones,
+  /// e.g. table.hot.recordcount or table.hot.requestdistribution. The
+  /// record counts of the tables add up to recordcount, which is split
+  /// evenly among the tables that do not set theirs.
+  ///
+  static const std::string TABLES_PROPERTY;
+
+  ///
+  /// The name of the per-table property for the relative share of the Run
+  /// operations that go to a table (default: its record count).
+  ///
+  static const std::string TABLE_PROPORTION_PROPERTY;
   
   /// 
   /// The name of the property for the number of fields in a record.
@@ -100,13 +122,81 @@ class CoreWorkload {
   ///
   static const std::string READMODIFYWRITE_PROPORTION_PROPERTY;
   static const std::string READMODIFYWRITE_PROPORTION_DEFAULT;
+
+  ///
+  /// The name of the property for the proportion of multi-key
+  /// transactions, which read several records and update some of them
+  /// atomically.
+  ///
+  static const std::string TRANSACTION_PROPORTION_PROPERTY;
+  static const std::string TRANSACTION_PROPORTION_DEFAULT;
+
+  ///
+  /// The name of the property for the number of records a multi-key
+  /// transaction reads.
+  ///
+  static const std::string TRANSACTION_KEYS_PROPERTY;
+  static const std::string TRANSACTION_KEYS_DEFAULT;
+
+  ///
+  /// The name of the property for the number of the records read by a
+  /// multi-key transaction that it then updates (at most the keys read).
+  ///
+  static const std::string TRANSACTION_UPDATES_PROPERTY;
+  static const std::string TRANSACTION_UPDATES_DEFAULT;
   
   /// 
   /// The name of the property for the the distribution of request keys.
-  /// Options are "uniform", "zipfian" and "latest".
+  /// Options are "uniform", "zipfian", "latest", "hotspot" and
+  /// "shifting_hotspot".
   ///
   static const std::string REQUEST_DISTRIBUTION_PROPERTY;
   static const std::string REQUEST_DISTRIBUTION_DEFAULT;
+
+  ///
+  /// The name of the property for the zipfian constant (theta, between 0
+  /// and 1) of the zipfian request, scan length and field length
+  /// distributions and of the latest distribution.
+  ///
+  static const std::string ZIPFIAN_CONSTANT_PROPERTY;
+  static const std::string ZIPFIAN_CONSTANT_DEFAULT;
+
+  ///
+  /// The name of the property for a number of samples to draw from the
+  /// zipfian request distribution before a Run phase, to report the
+  /// empirical frequencies of the most popular keys (0 for none).
+  ///
+  static const std::string ZIPFIAN_VERIFY_PROPERTY;
+  static const std::string ZIPFIAN_VERIFY_DEFAULT;
+
+  ///
+  /// The name of the property for the fraction of keys in the hot set of
+  /// the hotspot distributions.
+  ///
+  static const std::string HOTSPOT_DATA_FRACTION_PROPERTY;
+  static const std::string HOTSPOT_DATA_FRACTION_DEFAULT;
+
+  ///
+  /// The name of the property for the fraction of operations that go to
+  /// the hot set of the hotspot distributions.
+  ///
+  static const std::string HOTSPOT_OPN_FRACTION_PROPERTY;
+  static const std::string HOTSPOT_OPN_FRACTION_DEFAULT;
+
+  ///
+  /// The names of the properties for how often the hot set of the
+  /// shifting_hotspot distribution moves: every given number of operations
+  /// across all threads, or every given number of seconds.
+  ///
+  static const std::string HOTSPOT_SHIFT_OPS_PROPERTY;
+  static const std::string HOTSPOT_SHIFT_INTERVAL_PROPERTY;
+
+  ///
+  /// The name of the property for the fraction of the keys by which the
+  /// hot set moves at each shift (default: hotspotdatafraction, so that
+  /// every hot set is new).
+  ///
+  static const std::string HOTSPOT_SHIFT_FRACTION_PROPERTY;
   
   ///
   /// The name of the property for adding zero padding to record numbers in order to match 
@@ -115,6 +205,14 @@ class CoreWorkload {
   static const std::string ZERO_PADDING_PROPERTY;
   static const std::string ZERO_PADDING_DEFAULT;
 
+  ///
+  /// The name of the property for the string that starts every key.
+  /// Run workloads that share a database use different prefixes to keep
+  /// their records apart.
+  ///
+  static const std::string KEY_PREFIX_PROPERTY;
+  static const std::string KEY_PREFIX_DEFAULT;
+
   /// 
   /// The name of the property for the max scan length (number of records).
   ///
@@ -137,6 +235,29 @@ class CoreWorkload {
 
   static const std::string INSERT_START_PROPERTY;
   static const std::string INSERT_START_DEFAULT;
+
+  ///
+  /// The name of the property for a binary trace (see trace.h) to replay
+  /// in the Run phase instead of generating operations. Operations, keys,
+  /// value sizes and scan lengths are taken from the trace, which wraps
+  /// around if operationcount exceeds its length.
+  ///
+  static const std::string TRACE_FILE_PROPERTY;
+
+  ///
+  /// The name of the property for the target throughput of all client
+  /// threads together, in operations per second (0 for no throttling).
+  ///
+  static const std::string TARGET_PROPERTY;
+  static const std::string TARGET_DEFAULT;
+
+  ///
+  /// The name of the property for the number of operations a client thread
+  /// generates before issuing them, with the reads, updates and inserts
+  /// among them grouped into batches (1 for no batching).
+  ///
+  static const std::string BATCH_SIZE_PROPERTY;
+  static const std::string BATCH_SIZE_DEFAULT;
   
   static const std::string RECORD_COUNT_PROPERTY;
   static const std::string OPERATION_COUNT_PROPERTY;
@@ -146,7 +267,30 @@ class CoreWorkload {
   /// Called once, in the main client thread, before any operations are started.
   ///
   virtual void InitLoadWorkload(const utils::Properties &p, unsigned int nthreads, unsigned int this_thread, BatchedCounterGenerator *key_generator);
-  virtual void InitRunWorkload(const utils::Properties &p, unsigned int nthreads, unsigned int this_thread);
+  virtual void InitRunWorkload(const utils::Properties &p, unsigned int nthreads, unsigned int this_thread,
+                               TraceReader *trace = NULL, WorkloadSchedule *schedule = NULL);
+
+  ///
+  /// Starts the clocks of the Run phase at start, the same for all threads.
+  /// Called in the main thread, right before client threads start.
+  ///
+  void StartRun(std::chrono::steady_clock::time_point start);
+
+  ///
+  /// The zipfian constant of a workload.
+  ///
+  static double ZipfianConstant(const utils::Properties &p);
+
+  ///
+  /// The batch size of a workload.
+  ///
+  static uint64_t BatchSize(const utils::Properties &p);
+
+  ///
+  /// The number of keys the zipfian request distribution draws from,
+  /// leaving room for the keys inserted during the Run phase.
+  ///
+  static uint64_t ZipfianKeySpace(const utils::Properties &p, uint64_t record_count);
 
   void InitKeyBuffer(std::string &buffer);
 
@@ -155,16 +299,28 @@ class CoreWorkload {
   virtual void UpdateValues(std::vector<ycsbc::DB::KVPair> &values);
   virtual void BuildUpdate(std::vector<ycsbc::DB::KVPair> &update);
   
-  virtual std::string NextTable() { return table_name_; }
+  virtual std::string NextTable() { return table_ ? table_->name : table_name_; }
+  const std::string &key_prefix() const { return key_prefix_; }
   virtual void NextSequenceKey(std::string &buffer); /// Used for loading data
   virtual std::string NextTransactionKey(); /// Used for transactions
-  virtual Operation NextOperation() { return op_chooser_.Next(); }
+  virtual Operation NextOperation();
   virtual std::string NextFieldName();
-  virtual size_t NextScanLength() { return scan_len_chooser_->Next(); }
+  virtual size_t NextScanLength();
   
   bool read_all_fields() const { return read_all_fields_; }
   bool write_all_fields() const { return write_all_fields_; }
 
+  ///
+  /// Nanoseconds this thread should spend per operation to meet the target
+  /// throughput of the current schedule segment, or 0 for no throttling.
+  ///
+  uint64_t op_interval_ns() const { return op_interval_ns_; }
+
+  uint64_t batch_size() const { return batch_size_; }
+
+  size_t transaction_keys() const { return transaction_keys_; }
+  size_t transaction_updates() const { return transaction_updates_; }
+
   CoreWorkload() :
       generator_(),
       field_count_(0),
@@ -172,50 +328,159 @@ class CoreWorkload {
       write_all_fields_(false),
       field_len_generator_(NULL),
       key_generator_(NULL),
-      key_generator_batch_(0),
-      batch_remaining_(0),
-      op_chooser_(generator_),
+      op_chooser_(NULL),
       key_chooser_(NULL),
       field_chooser_(NULL),
       scan_len_chooser_(NULL),
       insert_key_sequence_(3),
       ordered_inserts_(true),
       record_count_(0),
-      uniform_letter_dist_('a', 'z')
+      uniform_letter_dist_('a', 'z'),
+      trace_(NULL),
+      trace_pos_(NULL),
+      trace_end_(NULL),
+      trace_record_(NULL),
+      schedule_(NULL),
+      segment_(0),
+      segment_ops_(0),
+      op_interval_ns_(0),
+      batch_size_(1),
+      transaction_keys_(0),
+      transaction_updates_(0),
+      table_(NULL),
+      table_chooser_(NULL)
   {}
   
   virtual ~CoreWorkload() {
+    ClearTables();
     if (field_len_generator_) delete field_len_generator_;
-    if (key_chooser_) delete key_chooser_;
     if (field_chooser_) delete field_chooser_;
-    if (scan_len_chooser_) delete scan_len_chooser_;
+    ClearSegments();
   }
   
  protected:
+  ///
+  /// The choosers of one schedule segment (or of the whole Run phase).
+  ///
+  struct RunSegment {
+    RunSegment(std::default_random_engine &generator) :
+        op_chooser(generator), key_chooser(NULL), shifting_hotspot(NULL),
+        scan_len_chooser(NULL) { }
+    ~RunSegment() {
+      if (key_chooser) delete key_chooser;
+      if (scan_len_chooser) delete scan_len_chooser;
+    }
+    DiscreteGenerator<Operation> op_chooser;
+    Generator<uint64_t> *key_chooser;
+    ShiftingHotspotGenerator *shifting_hotspot; /// key_chooser, if it shifts in time
+    Generator<uint64_t> *scan_len_chooser;
+    bool read_all_fields;
+    bool write_all_fields;
+    uint64_t op_interval_ns;
+  };
+
+  RunSegment *BuildSegment(const utils::Properties &p, unsigned int nthreads);
+  void SwitchSegment(size_t i);
+  void StartSegment(size_t i, std::chrono::steady_clock::time_point start);
+  void ClearSegments();
+
+  /// KeyBatch::start before the first batch of keys is claimed
+  static const uint64_t kNoBatch = UINT64_MAX;
+
+  ///
+  /// The batch of key numbers a thread last claimed from a
+  /// BatchedCounterGenerator.
+  ///
+  struct KeyBatch {
+    uint64_t start;     /// kNoBatch before the first batch is claimed
+    uint64_t next;
+    uint64_t remaining;
+    void Reset() { start = kNoBatch; next = 0; remaining = 0; }
+  };
+
+  static uint64_t NextKeyNum(BatchedCounterGenerator *generator, KeyBatch &batch);
+
+  ///
+  /// Inserts of the Run phase into table i take key numbers from
+  /// (i + 1) * kTableInsertBase on, past those of the Load phase.
+  ///
+  static const uint64_t kTableInsertBase = 1ULL << 48;
+
+  ///
+  /// A table of a multi-table workload: a range of key numbers, with its
+  /// own record size and, in the Run phase, its own segment (the one of
+  /// the same index) and its own sequence of inserted keys. Records are
+  /// numbered from 0 within their table: the first record_count are
+  /// loaded, and the following ones inserted in the Run phase.
+  ///
+  struct Table {
+    std::string name;
+    uint64_t key_base;    /// Key number of the first record
+    uint64_t insert_base; /// Key number of record n >= record_count, minus n
+    BatchedCounterGenerator *inserts; /// Numbers Run inserts, or NULL
+    KeyBatch insert_batch;
+    uint64_t record_count;
+    int field_count;
+    Generator<uint64_t> *field_len_generator;
+    Generator<uint64_t> *field_chooser;
+  };
+
+  static std::vector<std::string> TableNames(const utils::Properties &p);
+  void InitTables(const utils::Properties &p);
+  void InitRunTables(const utils::Properties &p, unsigned int nthreads);
+  void SwitchTable(size_t i);
+  void ClearTables();
+  static std::string TablePrefix(const std::string &name) { return "table." + name + "."; }
+
+  ///
+  /// The key number of record n of table, and whether it was written.
+  ///
+  static uint64_t TableKeyNum(const Table &table, uint64_t n) {
+    return n < table.record_count ? table.key_base + n : table.insert_base + n;
+  }
+  bool TableHas(const Table &table, uint64_t n) const;
+
   Generator<uint64_t> *GetFieldLenGenerator(const utils::Properties &p);
   std::string BuildKeyName(uint64_t key_num);
   void UpdateKeyName(uint64_t key_num, std::string &buffer);
 
   std::default_random_engine generator_;
   std::string table_name_;
+  std::string key_prefix_;
   int field_count_;
   bool read_all_fields_;
   bool write_all_fields_;
   Generator<uint64_t> *field_len_generator_;
   BatchedCounterGenerator *key_generator_;
-  uint64_t key_batch_start_;
-  CounterGenerator key_generator_batch_;
-  uint64_t batch_remaining_;
-  DiscreteGenerator<Operation> op_chooser_;
-  Generator<uint64_t> *key_chooser_;
+  KeyBatch key_batch_;
+  DiscreteGenerator<Operation> *op_chooser_; /// Owned by the current segment
+  Generator<uint64_t> *key_chooser_;         /// Owned by the current segment
   Generator<uint64_t> *field_chooser_;
-  Generator<uint64_t> *scan_len_chooser_;
+  Generator<uint64_t> *scan_len_chooser_;    /// Owned by the current segment
   CounterGenerator insert_key_sequence_;
   bool ordered_inserts_;
   size_t record_count_;
   int zero_padding_;
 
   std::uniform_int_distribution<char> uniform_letter_dist_;
+
+  TraceReader *trace_; /// Shared trace being replayed, or NULL
+  const char *trace_pos_;
+  const char *trace_end_;
+  const char *trace_record_; /// Record of the current replayed operation
+
+  std::vector<RunSegment *> segments_;
+  WorkloadSchedule *schedule_; /// Shared schedule of the Run phase, or NULL
+  size_t segment_;
+  uint64_t segment_ops_; /// Operations since the last schedule check
+  uint64_t op_interval_ns_;
+  uint64_t batch_size_;
+  size_t transaction_keys_;
+  size_t transaction_updates_;
+
+  std::vector<Table *> tables_; /// Empty for a single table
+  Table *table_;                /// Current table, or NULL
+  DiscreteGenerator<size_t> *table_chooser_;
 };
 
 inline void CoreWorkload::InitKeyBuffer(std::string &buffer) {
@@ -223,26 +488,68 @@ inline void CoreWorkload::InitKeyBuffer(std::string &buffer) {
 }
 
 inline void CoreWorkload::NextSequenceKey(std::string &buffer) {
-  if (batch_remaining_ == 0) {
-    key_generator_->MarkCompleted(key_batch_start_);
-    key_batch_start_ = key_generator_->Next();
-    key_generator_batch_.Set(key_batch_start_);
-    batch_remaining_ = key_generator_->BatchSize();
+  if (trace_record_) {
+    buffer.assign(TraceReader::Key(trace_record_),
+                  TraceReader::Record(trace_record_)->key_size);
+    return;
+  }
+  if (table_ && table_->inserts) {
+    // Run phase inserts go to the table of the operation
+    uint64_t n = NextKeyNum(table_->inserts, table_->insert_batch);
+    UpdateKeyName(TableKeyNum(*table_, n), buffer);
+    return;
+  }
+  uint64_t key_num = NextKeyNum(key_generator_, key_batch_);
+  if (!tables_.empty() && key_num < tables_.back()->key_base + tables_.back()->record_count) {
+    // Loading: key numbers map to tables in order
+    size_t i = 0;
+    while (key_num >= tables_[i]->key_base + tables_[i]->record_count) {
+      i++;
+    }
+    SwitchTable(i);
   }
-  uint64_t key_num = key_generator_batch_.Next();
-  batch_remaining_--;
   //buffer = BuildKeyName(key_num);
   UpdateKeyName(key_num, buffer);
 }
 
 inline std::string CoreWorkload::NextTransactionKey() {
+  if (trace_record_) {
+    return std::string(TraceReader::Key(trace_record_),
+                       TraceReader::Record(trace_record_)->key_size);
+  }
   uint64_t key_num;
+  if (table_) {
+    do {
+      key_num = key_chooser_->Next();
+    } while (!TableHas(*table_, key_num));
+    return BuildKeyName(TableKeyNum(*table_, key_num));
+  }
   do {
     key_num = key_chooser_->Next();
   } while (key_num > key_generator_->Last());
   return BuildKeyName(key_num);
 }
 
+inline uint64_t CoreWorkload::NextKeyNum(BatchedCounterGenerator *generator, KeyBatch &batch) {
+  if (batch.remaining == 0) {
+    if (batch.start != kNoBatch) {
+      generator->MarkCompleted(batch.start);
+    }
+    batch.start = generator->Next();
+    batch.next = batch.start;
+    batch.remaining = generator->BatchSize();
+  }
+  batch.remaining--;
+  return batch.next++;
+}
+
+inline bool CoreWorkload::TableHas(const Table &table, uint64_t n) const {
+  if (n < table.record_count) {
+    return table.key_base + n <= key_generator_->Last();
+  }
+  return table.inserts && n < table.inserts->Last();
+}
+
 inline std::string CoreWorkload::BuildKeyName(uint64_t key_num) {
   if (!ordered_inserts_) {
     key_num = utils::Hash(key_num);
@@ -250,7 +557,7 @@ inline std::string CoreWorkload::BuildKeyName(uint64_t key_num) {
   std::string key_num_str = std::to_string(key_num);
   int zeros = zero_padding_ - key_num_str.length();
   zeros = std::max(0, zeros);
-  return std::string("user").append(zeros, '0').append(key_num_str);
+  return std::string(key_prefix_).append(zeros, '0').append(key_num_str);
 }
 
 inline void CoreWorkload::UpdateKeyName(uint64_t key_num, std::string &buffer) {
@@ -260,12 +567,49 @@ inline void CoreWorkload::UpdateKeyName(uint64_t key_num, std::string &buffer) {
   char internal_buffer[21];
   snprintf(internal_buffer, sizeof(internal_buffer), "%020lu", key_num);
   int len = buffer.size();
-  assert(24 <= len);
+  assert(20 <= len);
   for (unsigned int i = 0; i < sizeof(internal_buffer) - 1; i++) {
     buffer[len - 20 + i] = internal_buffer[i];
   }
 }
 
+inline Operation CoreWorkload::NextOperation() {
+  if (table_chooser_) {
+    SwitchTable(table_chooser_->Next());
+  }
+  if (schedule_ && ++segment_ops_ == WorkloadSchedule::kSyncOps) {
+    size_t segment = schedule_->Advance(segment_ops_);
+    segment_ops_ = 0;
+    if (segment != segment_) {
+      SwitchSegment(segment);
+      StartSegment(segment, schedule_->SegmentStart(segment));
+    }
+  }
+  if (!trace_) {
+    return op_chooser_->Next();
+  }
+  if (trace_pos_ == trace_end_) {
+    trace_->Claim(&trace_pos_, &trace_end_);
+  }
+  trace_record_ = trace_pos_;
+  trace_pos_ = TraceReader::NextRecord(trace_pos_);
+  switch (TraceReader::Record(trace_record_)->op) {
+    case kTraceRead: return READ;
+    case kTraceUpdate: return UPDATE;
+    case kTraceInsert: return INSERT;
+    case kTraceScan: return SCAN;
+    case kTraceDelete: return DELETE;
+    default: throw utils::Exception("Unknown operation in trace");
+  }
+}
+
+inline size_t CoreWorkload::NextScanLength() {
+  if (trace_record_ && TraceReader::Record(trace_record_)->value_size) {
+    return TraceReader::Record(trace_record_)->value_size;
+  }
+  return scan_len_chooser_->Next();
+}
+
 inline std::string CoreWorkload::NextFieldName() {
   return std::string("field").append(std::to_string(field_chooser_->Next()));
 }
@@ -11,6 +11,7 @@
 
 #include <vector>
 #include <string>
+#include <ostream>
 
 namespace ycsbc {
 
@@ -89,6 +90,89 @@ class DB {
   /// @return Zero on success, a non-zero error code on error.
   ///
   virtual int Delete(const std::string &table, const std::string &key) = 0;
+  ///
+  /// Reads a batch of records. Backends without a batched read API read
+  /// them one at a time.
+  ///
+  /// @param table The name of the table.
+  /// @param keys The keys of the records to read.
+  /// @param fields For each key, the list of fields to read, or NULL for
+  ///        all of them.
+  /// @param results For each key, a vector of field/value pairs.
+  /// @param statuses For each key, the status Read() would return.
+  ///
+  virtual void BatchRead(const std::string &table, const std::vector<std::string> &keys,
+                         const std::vector<const std::vector<std::string> *> &fields,
+                         std::vector<std::vector<KVPair>> &results,
+                         std::vector<int> &statuses) {
+    results.resize(keys.size());
+    statuses.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      statuses[i] = Read(table, keys[i], fields[i], results[i]);
+    }
+  }
+  ///
+  /// Updates a batch of records, as Update() does one record.
+  ///
+  /// @param statuses For each key, the status Update() would return.
+  ///
+  virtual void BatchUpdate(const std::string &table, const std::vector<std::string> &keys,
+                           std::vector<std::vector<KVPair>> &values,
+                           std::vector<int> &statuses) {
+    statuses.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      statuses[i] = Update(table, keys[i], values[i]);
+    }
+  }
+  ///
+  /// Inserts a batch of records, as Insert() does one record.
+  ///
+  /// @param statuses For each key, the status Insert() would return.
+  ///
+  virtual void BatchInsert(const std::string &table, const std::vector<std::string> &keys,
+                           std::vector<std::vector<KVPair>> &values,
+                           std::vector<int> &statuses) {
+    statuses.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      statuses[i] = Insert(table, keys[i], values[i]);
+    }
+  }
+  ///
+  /// Reads several records, then updates the first of them, atomically.
+  /// Backends without transactions read and update the records one at a
+  /// time, with no atomicity.
+  ///
+  /// @param table The name of the table.
+  /// @param keys The keys of the records to read.
+  /// @param fields The list of fields to read, or NULL for all of them.
+  /// @param results For each key, a vector of field/value pairs.
+  /// @param values Field/value pairs to write to the records of the first
+  ///        values.size() keys, as Update() does.
+  /// @return Zero on success, kErrorConflict if the transaction was
+  ///         aborted, or another non-zero error code on error/record-miss.
+  ///
+  virtual int ExecuteTransaction(const std::string &table, const std::vector<std::string> &keys,
+                                 const std::vector<std::string> *fields,
+                                 std::vector<std::vector<KVPair>> &results,
+                                 std::vector<std::vector<KVPair>> &values) {
+    results.resize(keys.size());
+    int status = kOK;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      int read = Read(table, keys[i], fields, results[i]);
+      if (read == kOK && i < values.size()) {
+        read = Update(table, keys[i], values[i]);
+      }
+      if (status == kOK) {
+        status = read;
+      }
+    }
+    return status;
+  }
+  ///
+  /// Prints statistics gathered by the DB since the last call, if any.
+  /// Called in the main thread at the end of each phase.
+  ///
+  virtual void PrintStats(std::ostream &out) { }
   
   virtual ~DB() { }
 };
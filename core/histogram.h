@@ -0,0 +1,116 @@
+//
+//  histogram.h
+//  YCSB-C
+//
+//  Log-linear latency histogram. Values are bucketed by their highest set
+//  bit, with kSubBuckets linear sub-buckets per power of two, so reported
+//  percentiles are within about 3% of the recorded values.
+//
+//  A histogram is not thread-safe: keep one per client thread and Merge
+//  them once the threads are done.
+//
+
+#ifndef YCSB_C_HISTOGRAM_H_
+#define YCSB_C_HISTOGRAM_H_
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+namespace utils {
+
+class Histogram {
+ public:
+  Histogram() { Reset(); }
+
+  void Reset() {
+    memset(buckets_, 0, sizeof(buckets_));
+    count_ = 0;
+    sum_ = 0;
+    min_ = UINT64_MAX;
+    max_ = 0;
+  }
+
+  void Record(uint64_t value) {
+    buckets_[BucketIndex(value)]++;
+    count_++;
+    sum_ += value;
+    if (value < min_) min_ = value;
+    if (value > max_) max_ = value;
+  }
+
+  void Merge(const Histogram &other) {
+    for (int i = 0; i < kBuckets; ++i) {
+      buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (other.min_ < min_) min_ = other.min_;
+    if (other.max_ > max_) max_ = other.max_;
+  }
+
+  uint64_t Count() const { return count_; }
+  uint64_t Min() const { return count_ ? min_ : 0; }
+  uint64_t Max() const { return max_; }
+  double Mean() const { return count_ ? (double)sum_ / count_ : 0; }
+
+  ///
+  /// The value below which the given percentage (0-100) of values fall.
+  ///
+  uint64_t Percentile(double percent) const {
+    if (count_ == 0) return 0;
+    uint64_t rank = (uint64_t)(percent / 100 * count_);
+    if (rank >= count_) rank = count_ - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+      seen += buckets_[i];
+      if (seen > rank) {
+        uint64_t value = BucketMidpoint(i);
+        return value < min_ ? min_ : (value > max_ ? max_ : value);
+      }
+    }
+    return max_;
+  }
+
+  ///
+  /// Prints avg, p50, p99, p99.9 and max, tab-separated, in units of
+  /// divisor (e.g. 1000 for microseconds out of nanoseconds).
+  ///
+  void PrintSummary(std::ostream &out, double divisor) const {
+    out << Mean() / divisor << '\t' << Percentile(50) / divisor << '\t'
+        << Percentile(99) / divisor << '\t' << Percentile(99.9) / divisor << '\t'
+        << Max() / divisor;
+  }
+
+ private:
+  static const int kSubBucketBits = 5;
+  static const int kSubBuckets = 1 << kSubBucketBits;
+  static const int kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  ///
+  /// Values below 2 * kSubBuckets get a bucket each. Above that, a value
+  /// with its highest bit at position kSubBucketBits + shift falls into
+  /// bucket shift * kSubBuckets + (value >> shift).
+  ///
+  static int BucketIndex(uint64_t value) {
+    if (value < (uint64_t)kSubBuckets) return (int)value;
+    int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+    return shift * kSubBuckets + (int)(value >> shift);
+  }
+
+  static uint64_t BucketMidpoint(int index) {
+    int shift = index < 2 * kSubBuckets ? 0 : index / kSubBuckets - 1;
+    uint64_t lower = (uint64_t)(index - shift * kSubBuckets) << shift;
+    return lower + (((uint64_t)1 << shift) - 1) / 2;
+  }
+
+  uint64_t buckets_[kBuckets];
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t min_;
+  uint64_t max_;
+};
+
+} // utils
+
+#endif // YCSB_C_HISTOGRAM_H_
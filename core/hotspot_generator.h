@@ -0,0 +1,140 @@
+//
+//  hotspot_generator.h
+//  YCSB-C
+//
+//  A hot set of keys receiving a given fraction of the operations, the
+//  rest going uniformly to the other keys. The shifting variant moves the
+//  hot set through the key space, after a number of operations or an
+//  amount of time, wrapping around at the end.
+//
+
+#ifndef YCSB_C_HOTSPOT_GENERATOR_H_
+#define YCSB_C_HOTSPOT_GENERATOR_H_
+
+#include "generator.h"
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace ycsbc {
+
+class HotspotGenerator : public Generator<uint64_t> {
+ public:
+  // Both min and max are inclusive
+  HotspotGenerator(std::default_random_engine &generator, uint64_t min, uint64_t max,
+                   double hot_data_fraction, double hot_op_fraction) :
+    generator_(generator),
+    base_(min),
+    num_items_(max - min + 1),
+    num_hot_(num_items_ * hot_data_fraction),
+    hot_op_fraction_(hot_op_fraction),
+    offset_(0),
+    op_dist_(0.0, 1.0)
+  {
+    assert(hot_data_fraction >= 0 && hot_data_fraction <= 1);
+    assert(hot_op_fraction >= 0 && hot_op_fraction <= 1);
+    if (num_hot_ == 0) num_hot_ = 1;
+    hot_dist_ = std::uniform_int_distribution<uint64_t>(0, num_hot_ - 1);
+    if (num_hot_ < num_items_) {
+      cold_dist_ = std::uniform_int_distribution<uint64_t>(0, num_items_ - num_hot_ - 1);
+    }
+    Next();
+  }
+
+  uint64_t Next();
+  uint64_t Last() { return last_int_; }
+
+  ///
+  /// Moves the start of the hot set to the given position in the key range.
+  ///
+  void MoveHotSet(uint64_t offset) { offset_ = offset % num_items_; }
+
+ protected:
+  std::default_random_engine &generator_;
+  const uint64_t base_;
+  const uint64_t num_items_;
+  uint64_t num_hot_;
+  const double hot_op_fraction_;
+  uint64_t offset_; /// Position of the first hot key
+  std::uniform_real_distribution<double> op_dist_;
+  std::uniform_int_distribution<uint64_t> hot_dist_;
+  std::uniform_int_distribution<uint64_t> cold_dist_;
+  uint64_t last_int_;
+};
+
+inline uint64_t HotspotGenerator::Next() {
+  uint64_t pos;
+  if (num_hot_ == num_items_ || op_dist_(generator_) < hot_op_fraction_) {
+    pos = offset_ + hot_dist_(generator_);
+  } else {
+    // Cold keys follow the hot set, wrapping around
+    pos = offset_ + num_hot_ + cold_dist_(generator_);
+  }
+  return last_int_ = base_ + pos % num_items_;
+}
+
+class ShiftingHotspotGenerator : public HotspotGenerator {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  ///
+  /// The hot set moves by shift_fraction of the key range every shift_ops
+  /// calls to Next() or every shift_seconds, whichever is set.
+  ///
+  ShiftingHotspotGenerator(std::default_random_engine &generator, uint64_t min, uint64_t max,
+                           double hot_data_fraction, double hot_op_fraction,
+                           double shift_fraction, uint64_t shift_ops, double shift_seconds) :
+    HotspotGenerator(generator, min, max, hot_data_fraction, hot_op_fraction),
+    shift_(num_items_ * shift_fraction),
+    shift_ops_(shift_ops),
+    shift_interval_(std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(shift_seconds))),
+    ops_(0),
+    start_(Clock::now())
+  {
+    assert(shift_ops_ > 0 || shift_seconds > 0);
+    if (shift_ == 0) shift_ = 1;
+  }
+
+  uint64_t Next();
+
+  ///
+  /// Restarts the shifts from the first hot set, with the interval counted
+  /// from start: the start of the phase or segment, shared by all threads.
+  ///
+  void Start(Clock::time_point start) {
+    start_ = start;
+    ops_ = 0;
+    MoveHotSet(0);
+  }
+
+ private:
+  /// Calls to Next() between two looks at the clock
+  static const uint64_t kClockCheckOps = 64;
+
+  uint64_t shift_;
+  const uint64_t shift_ops_;
+  const Clock::duration shift_interval_;
+  uint64_t ops_;
+  Clock::time_point start_;
+};
+
+inline uint64_t ShiftingHotspotGenerator::Next() {
+  ++ops_;
+  if (shift_ops_ > 0) {
+    if (ops_ % shift_ops_ == 0) {
+      MoveHotSet(offset_ + shift_);
+    }
+  } else if (ops_ % kClockCheckOps == 0) {
+    // Derived from the clock, so that all threads agree on the hot set
+    uint64_t shifts = (Clock::now() - start_) / shift_interval_;
+    MoveHotSet(shifts % num_items_ * (shift_ % num_items_));
+  }
+  return HotspotGenerator::Next();
+}
+
+} // ycsbc
+
+#endif // YCSB_C_HOTSPOT_GENERATOR_H_
@@ -30,6 +30,11 @@ class Properties {
 
   void SetProperty(const std::string &key, const std::string &value);
   bool Load(std::ifstream &input);
+
+  ///
+  /// Returns a copy in which each property "<prefix><key>" overrides "<key>".
+  ///
+  Properties Overlay(const std::string &prefix) const;
  private:
   std::map<std::string, std::string> properties_;
 };
@@ -64,6 +69,16 @@ inline void Properties::SetProperty(const std::string &key,
   properties_[key] = value;
 }
 
+inline Properties Properties::Overlay(const std::string &prefix) const {
+  Properties result(*this);
+  for (auto it = properties_.lower_bound(prefix);
+       it != properties_.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+       ++it) {
+    result.SetProperty(it->first.substr(prefix.size()), it->second);
+  }
+  return result;
+}
+
 inline bool Properties::Load(std::ifstream &input) {
   if (!input.is_open()) throw utils::Exception("File not open!");
 
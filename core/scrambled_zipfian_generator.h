@@ -21,28 +21,32 @@ class ScrambledZipfianGenerator : public Generator<uint64_t> {
  public:
   ScrambledZipfianGenerator(std::default_random_engine &generator,
                             uint64_t min, uint64_t max,
-      double zipfian_const = ZipfianGenerator::kZipfianConst) :
+      double zipfian_const = ZipfianGenerator::kZipfianConst,
+      double zeta_n = 0) :
       base_(min), num_items_(max - min + 1),
-      generator_(generator, min, max, zipfian_const) { }
+      generator_(generator, 0, max - min, zipfian_const, zeta_n) { }
   
-  ScrambledZipfianGenerator(std::default_random_engine &generator, uint64_t num_items) :
-    ScrambledZipfianGenerator(generator, 0, num_items - 1) { }
+  ScrambledZipfianGenerator(std::default_random_engine &generator, uint64_t num_items,
+                            double zipfian_const = ZipfianGenerator::kZipfianConst,
+                            double zeta_n = 0) :
+    ScrambledZipfianGenerator(generator, 0, num_items - 1, zipfian_const, zeta_n) { }
   
   uint64_t Next();
   uint64_t Last();
+
+  ///
+  /// The item that the zipfian rank is mapped to.
+  ///
+  uint64_t Scramble(uint64_t rank) const {
+    return base_ + utils::FNVHash64(rank) % num_items_;
+  }
   
  private:
   const uint64_t base_;
   const uint64_t num_items_;
   ZipfianGenerator generator_;
-
-  uint64_t Scramble(uint64_t value) const;
 };
 
-inline uint64_t ScrambledZipfianGenerator::Scramble(uint64_t value) const {
-  return base_ + utils::FNVHash64(value) % num_items_;
-}
-
 inline uint64_t ScrambledZipfianGenerator::Next() {
   return Scramble(generator_.Next());
 }
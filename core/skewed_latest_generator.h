@@ -19,8 +19,9 @@ namespace ycsbc {
 
 class SkewedLatestGenerator : public Generator<uint64_t> {
  public:
-  SkewedLatestGenerator(std::default_random_engine &generator, Generator &counter) :
-    basis_(counter), zipfian_(generator, basis_.Last()) {
+  SkewedLatestGenerator(std::default_random_engine &generator, Generator &counter,
+                        double zipfian_const = ZipfianGenerator::kZipfianConst) :
+    basis_(counter), zipfian_(generator, basis_.Last(), zipfian_const) {
     Next();
   }
   
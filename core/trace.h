@@ -0,0 +1,168 @@
+//
+//  trace.h
+//  YCSB-C
+//
+//  Binary key-value trace format written by trace_convert and replayed by
+//  CoreWorkload when the "tracefile" property is set.
+//
+//  A trace file is a TraceHeader followed by a sequence of records. Each
+//  record is a TraceRecord immediately followed by key_size bytes of key.
+//  All integers are little-endian.
+//
+
+#ifndef YCSB_C_TRACE_H_
+#define YCSB_C_TRACE_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "utils.h"
+
+namespace ycsbc {
+
+enum TraceOp : uint8_t {
+  kTraceRead = 0,
+  kTraceUpdate = 1,
+  kTraceInsert = 2,
+  kTraceScan = 3,
+  kTraceDelete = 4
+};
+
+const char kTraceMagic[8] = "YCSBTRC";
+const uint32_t kTraceVersion = 1;
+
+struct TraceHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+};
+
+struct TraceRecord {
+  uint64_t timestamp_us;
+  uint32_t value_size; ///< Value length for writes, record count for scans (0: workload default)
+  uint16_t key_size;
+  uint8_t op;
+  uint8_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 16, "TraceHeader must be packed");
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord must be packed");
+
+inline void InitTraceHeader(TraceHeader &header) {
+  memset(&header, 0, sizeof(header));
+  strncpy(header.magic, kTraceMagic, sizeof(header.magic));
+  header.version = kTraceVersion;
+}
+
+///
+/// Appends one encoded record to a buffer.
+///
+inline void AppendTraceRecord(std::string &buffer, uint64_t timestamp_us,
+                              TraceOp op, const char *key, size_t key_size,
+                              uint32_t value_size) {
+  assert(key_size <= UINT16_MAX);
+  TraceRecord record;
+  record.timestamp_us = timestamp_us;
+  record.value_size = value_size;
+  record.key_size = key_size;
+  record.op = op;
+  record.reserved = 0;
+  buffer.append(reinterpret_cast<const char *>(&record), sizeof(record));
+  buffer.append(key, key_size);
+}
+
+///
+/// A memory-mapped trace shared by all client threads of a Run phase.
+/// Threads claim records in small batches so that the global order of the
+/// trace is roughly preserved. The trace wraps around when exhausted.
+///
+class TraceReader {
+ public:
+  static const uint64_t kClaimBatch = 1024;
+
+  TraceReader(const std::string &filename);
+  ~TraceReader();
+
+  ///
+  /// Claims up to kClaimBatch consecutive records.
+  /// On return, [*begin, *end) holds the encoded records.
+  ///
+  void Claim(const char **begin, const char **end);
+
+  static const TraceRecord *Record(const char *pos) {
+    return reinterpret_cast<const TraceRecord *>(pos);
+  }
+  static const char *Key(const char *pos) { return pos + sizeof(TraceRecord); }
+  static const char *NextRecord(const char *pos) {
+    return Key(pos) + Record(pos)->key_size;
+  }
+
+ private:
+  const char *data_;
+  size_t size_;
+  const char *cursor_;
+  std::mutex mutex_;
+};
+
+inline TraceReader::TraceReader(const std::string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw utils::Exception("Cannot open trace file: " + filename);
+  }
+  struct stat st;
+  if (fstat(fd, &st) || (size_t)st.st_size <= sizeof(TraceHeader)) {
+    close(fd);
+    throw utils::Exception("Empty or unreadable trace file: " + filename);
+  }
+  size_ = st.st_size;
+  void *addr = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    throw utils::Exception("Cannot map trace file: " + filename);
+  }
+  madvise(addr, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char *>(addr);
+
+  const TraceHeader *header = reinterpret_cast<const TraceHeader *>(data_);
+  if (strncmp(header->magic, kTraceMagic, sizeof(header->magic)) ||
+      header->version != kTraceVersion) {
+    munmap(const_cast<char *>(data_), size_);
+    throw utils::Exception("Not a YCSB-C trace file: " + filename);
+  }
+  cursor_ = data_ + sizeof(TraceHeader);
+}
+
+inline TraceReader::~TraceReader() {
+  munmap(const_cast<char *>(data_), size_);
+}
+
+inline void TraceReader::Claim(const char **begin, const char **end) {
+  const char *limit = data_ + size_;
+  // A truncated tail record is treated as the end of the trace
+  auto complete = [limit](const char *pos) {
+    return pos + sizeof(TraceRecord) <= limit && NextRecord(pos) <= limit;
+  };
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!complete(cursor_)) {
+    cursor_ = data_ + sizeof(TraceHeader);
+  }
+  *begin = cursor_;
+  for (uint64_t i = 0; i < kClaimBatch && complete(cursor_); ++i) {
+    cursor_ = NextRecord(cursor_);
+  }
+  *end = cursor_;
+  if (*begin == *end) {
+    throw utils::Exception("Trace file contains no complete records");
+  }
+}
+
+} // ycsbc
+
+#endif // YCSB_C_TRACE_H_
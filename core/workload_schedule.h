@@ -0,0 +1,181 @@
+//
+//  workload_schedule.h
+//  YCSB-C
+//
+//  A Run phase split into segments, each with its own workload properties.
+//
+//  schedule=steady,burst,recovery
+//  schedule.steady.duration=60            (seconds)
+//  schedule.burst.operationcount=1000000  (operations across all threads)
+//  schedule.burst.updateproportion=0.9
+//  schedule.burst.target=50000
+//
+//  Any workload property may be overridden for a segment by prefixing it
+//  with "schedule.<name>.". The last segment may omit both duration and
+//  operationcount, and then runs until the phase ends.
+//
+
+#ifndef YCSB_C_WORKLOAD_SCHEDULE_H_
+#define YCSB_C_WORKLOAD_SCHEDULE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "properties.h"
+#include "utils.h"
+
+namespace ycsbc {
+
+class WorkloadSchedule {
+ public:
+  static const std::string SCHEDULE_PROPERTY;
+
+  ///
+  /// Number of operations a client thread performs between two checks of
+  /// the schedule, so that the shared state is not touched on every operation.
+  ///
+  static const uint64_t kSyncOps = 64;
+
+  WorkloadSchedule(const utils::Properties &p);
+
+  size_t NumSegments() const { return segments_.size(); }
+
+  ///
+  /// The workload properties of a segment.
+  ///
+  const utils::Properties &SegmentProperties(size_t i) const { return segments_[i].props; }
+
+  ///
+  /// Starts the clock of the first segment at start.
+  /// Called once, in the main thread, right before client threads start.
+  ///
+  void Start(std::chrono::steady_clock::time_point start);
+
+  ///
+  /// The time segment i started at, once it has been entered.
+  ///
+  std::chrono::steady_clock::time_point SegmentStart(size_t i) const {
+    return start_ + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(segments_[i].start_time));
+  }
+
+  ///
+  /// Accounts for ops performed by the calling thread, moves to the next
+  /// segment if the current one is over and returns the current segment.
+  ///
+  size_t Advance(uint64_t ops);
+
+  ///
+  /// Prints the throughput of each segment that was entered.
+  ///
+  void Report(std::ostream &out, const std::string &prefix,
+              uint64_t total_ops, double total_duration) const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Segment {
+    std::string name;
+    utils::Properties props;
+    double duration;   /// Seconds, or 0 if bounded by op_count
+    uint64_t op_count; /// Operations, or 0 if bounded by duration
+    double start_time;
+    uint64_t start_ops;
+  };
+
+  double Elapsed() const {
+    return std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+  std::vector<Segment> segments_;
+  Clock::time_point start_;
+  std::atomic<uint64_t> ops_;
+  std::atomic<size_t> current_;
+  std::mutex mutex_; /// Serializes segment transitions
+};
+
+inline WorkloadSchedule::WorkloadSchedule(const utils::Properties &p) :
+    ops_(0), current_(0) {
+  std::stringstream names(p.GetProperty(SCHEDULE_PROPERTY));
+  std::string name;
+  while (std::getline(names, name, ',')) {
+    name = utils::Trim(name);
+    if (name.empty()) continue;
+    std::string prefix = SCHEDULE_PROPERTY + "." + name + ".";
+    Segment segment;
+    segment.name = name;
+    segment.props = p.Overlay(prefix);
+    segment.duration = std::stod(p.GetProperty(prefix + "duration", "0"));
+    segment.op_count = std::stoull(p.GetProperty(prefix + "operationcount", "0"));
+    segment.start_time = 0;
+    segment.start_ops = 0;
+    segments_.push_back(segment);
+  }
+  if (segments_.empty()) {
+    throw utils::Exception("Empty workload schedule");
+  }
+  for (size_t i = 0; i + 1 < segments_.size(); ++i) {
+    if (segments_[i].duration <= 0 && segments_[i].op_count == 0) {
+      throw utils::Exception("Schedule segment " + segments_[i].name +
+                             " needs a duration or an operationcount");
+    }
+  }
+}
+
+inline void WorkloadSchedule::Start(Clock::time_point start) {
+  start_ = start;
+  ops_ = 0;
+  current_ = 0;
+}
+
+inline size_t WorkloadSchedule::Advance(uint64_t ops) {
+  uint64_t total = ops_.fetch_add(ops, std::memory_order_relaxed) + ops;
+  size_t current = current_.load(std::memory_order_acquire);
+  if (current + 1 == segments_.size()) {
+    return current;
+  }
+
+  const Segment &segment = segments_[current];
+  double elapsed = Elapsed();
+  bool over = (segment.duration > 0 &&
+               elapsed >= segment.start_time + segment.duration) ||
+              (segment.op_count > 0 &&
+               total >= segment.start_ops + segment.op_count);
+  if (!over) {
+    return current;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (current_.load(std::memory_order_relaxed) == current) {
+    Segment &next = segments_[current + 1];
+    next.start_time = elapsed;
+    next.start_ops = total;
+    current_.store(current + 1, std::memory_order_release);
+    std::cerr << "# Schedule segment:\t" << next.name << "\tat "
+              << elapsed << "s" << std::endl;
+  }
+  return current_.load(std::memory_order_acquire);
+}
+
+inline void WorkloadSchedule::Report(std::ostream &out, const std::string &prefix,
+                                     uint64_t total_ops, double total_duration) const {
+  size_t last = current_.load();
+  out << "# Schedule segment throughput (KTPS)" << std::endl;
+  for (size_t i = 0; i <= last; ++i) {
+    uint64_t end_ops = i < last ? segments_[i + 1].start_ops : total_ops;
+    double end_time = i < last ? segments_[i + 1].start_time : total_duration;
+    double duration = end_time - segments_[i].start_time;
+    out << prefix << '\t' << segments_[i].name << '\t';
+    out << (duration > 0 ? (end_ops - segments_[i].start_ops) / duration / 1000 : 0)
+        << std::endl;
+  }
+}
+
+} // ycsbc
+
+#endif // YCSB_C_WORKLOAD_SCHEDULE_H_
@@ -21,9 +21,14 @@ class ZipfianGenerator : public Generator<uint64_t> {
   constexpr static const double kZipfianConst = 0.99;
   static const uint64_t kMaxNumItems = (UINT64_MAX >> 24);
   
+  ///
+  /// zeta_n may be given if already computed for the same number of items
+  /// and zipfian constant (see Zeta()), to save the O(n) computation.
+  ///
   ZipfianGenerator(std::default_random_engine &generator,
                    uint64_t min, uint64_t max,
-                   double zipfian_const = kZipfianConst) :
+                   double zipfian_const = kZipfianConst,
+                   double zeta_n = 0) :
     generator_(generator),
     dist_(0.0, 1.0),
     num_items_(max - min + 1),
@@ -32,22 +37,33 @@ class ZipfianGenerator : public Generator<uint64_t> {
     n_for_zeta_(0)
   {
     assert(num_items_ >= 2 && num_items_ < kMaxNumItems);
+    assert(theta_ > 0 && theta_ < 1);
     zeta_2_ = Zeta(2, theta_);
     alpha_ = 1.0 / (1.0 - theta_);
-    RaiseZeta(num_items_);
+    if (zeta_n > 0) {
+      zeta_n_ = zeta_n;
+      n_for_zeta_ = num_items_;
+    } else {
+      RaiseZeta(num_items_);
+    }
     eta_ = Eta();
     
     Next();
   }
   
-  ZipfianGenerator(std::default_random_engine &generator, uint64_t num_items) :
-    ZipfianGenerator(generator, 0, num_items - 1, kZipfianConst) { }
+  ZipfianGenerator(std::default_random_engine &generator, uint64_t num_items,
+                   double zipfian_const = kZipfianConst) :
+    ZipfianGenerator(generator, 0, num_items - 1, zipfian_const) { }
   
   uint64_t Next(uint64_t num_items);
   
   uint64_t Next() { return Next(num_items_); }
 
   uint64_t Last();
+
+  static double Zeta(uint64_t num, double theta) {
+    return Zeta(0, num, theta, 0);
+  }
   
  private:
   ///
@@ -79,10 +95,6 @@ class ZipfianGenerator : public Generator<uint64_t> {
     }
     return zeta;
   }
-  
-  static double Zeta(uint64_t num, double theta) {
-    return Zeta(0, num, theta, 0);
-  }
 
   std::default_random_engine &generator_;
   std::uniform_real_distribution<float> dist_;
@@ -108,11 +120,11 @@ inline uint64_t ZipfianGenerator::Next(uint64_t num) {
   double uz = u * zeta_n_;
   
   if (uz < 1.0) {
-    return last_value_ = 0;
+    return last_value_ = base_;
   }
   
   if (uz < 1.0 + std::pow(0.5, theta_)) {
-    return last_value_ = 1;
+    return last_value_ = base_ + 1;
   }
 
   return last_value_ = base_ + num * std::pow(eta_ * u - eta_ + 1, alpha_);
@@ -0,0 +1,96 @@
+//
+//  zipfian_verifier.h
+//  YCSB-C
+//
+//  Samples the scrambled zipfian key chooser on several threads and prints
+//  the empirical frequencies of the most popular keys next to the
+//  theoretical ones, to check the skew a workload actually gets.
+//
+
+#ifndef YCSB_C_ZIPFIAN_VERIFIER_H_
+#define YCSB_C_ZIPFIAN_VERIFIER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "scrambled_zipfian_generator.h"
+
+namespace ycsbc {
+
+inline void VerifyZipfian(std::ostream &out, uint64_t num_items, double theta,
+                          uint64_t samples, unsigned int nthreads,
+                          unsigned int head = 10) {
+  // Only maps ranks to keys; the dummy zeta saves computing it twice
+  std::default_random_engine unused;
+  ScrambledZipfianGenerator scrambler(unused, num_items, theta, 1);
+
+  // The most popular keys, i.e. those of the first ranks
+  std::vector<uint64_t> keys;
+  for (uint64_t rank = 0; rank < num_items && keys.size() < head; ++rank) {
+    uint64_t key = scrambler.Scramble(rank);
+    if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+      keys.push_back(key);
+    }
+  }
+
+  // Scrambling may map several ranks to a key, so the probability of a key
+  // sums over all ranks. Zeta is computed along for the generators.
+  double zeta = 0;
+  std::vector<double> expected(keys.size(), 0);
+  for (uint64_t rank = 0; rank < num_items; ++rank) {
+    double weight = 1 / std::pow(rank + 1, theta);
+    zeta += weight;
+    uint64_t key = scrambler.Scramble(rank);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (keys[i] == key) expected[i] += weight;
+    }
+  }
+
+  std::vector<std::vector<uint64_t> > counts(nthreads, std::vector<uint64_t>(keys.size(), 0));
+  std::vector<std::thread> threads;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned int t = 0; t < nthreads; ++t) {
+    threads.push_back(std::thread([&, t]() {
+      std::default_random_engine generator(t * 3423452437 + 8349344563457);
+      ScrambledZipfianGenerator chooser(generator, num_items, theta, zeta);
+      std::vector<uint64_t> &count = counts[t];
+      uint64_t n = samples * (t + 1) / nthreads - samples * t / nthreads;
+      for (uint64_t i = 0; i < n; ++i) {
+        uint64_t key = chooser.Next();
+        for (size_t k = 0; k < keys.size(); ++k) {
+          if (keys[k] == key) {
+            count[k]++;
+            break;
+          }
+        }
+      }
+    }));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  out << "# Zipfian verification:\t" << samples << " samples\t" << num_items << " keys\ttheta "
+      << theta << '\t' << nthreads << " threads\t" << samples / seconds / 1e6 << " M samples/s" << std::endl;
+  out << "# key\tempirical\ttheoretical\terror (%)" << std::endl;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    uint64_t total = 0;
+    for (unsigned int t = 0; t < nthreads; ++t) {
+      total += counts[t][i];
+    }
+    double empirical = (double)total / samples;
+    double theoretical = expected[i] / zeta;
+    out << keys[i] << '\t' << empirical << '\t' << theoretical << '\t'
+        << 100 * (empirical - theoretical) / theoretical << std::endl;
+  }
+}
+
+} // ycsbc
+
+#endif // YCSB_C_ZIPFIAN_VERIFIER_H_
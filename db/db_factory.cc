@@ -12,10 +12,13 @@
 #include "db/basic_db.h"
 #include "db/lock_stl_db.h"
 #include "db/redis_db.h"
+#include "db/redis_async_db.h"
 #include "db/tbb_rand_db.h"
 #include "db/tbb_scan_db.h"
 #include "db/splinter_db.h"
 #include "db/rocks_db.h"
+#include "db/sharded_db.h"
+#include "db/striped_stl_db.h"
 
 using namespace std;
 using ycsbc::DB;
@@ -27,14 +30,19 @@ DB* DBFactory::CreateDB(utils::Properties &props, bool preloaded) {
   } else if (props["dbname"] == "lock_stl") {
     assert(!preloaded);
     return new LockStlDB;
+  } else if (props["dbname"] == "striped_stl") {
+    assert(!preloaded);
+    return new StripedStlDB(props.GetIntProperty("striped.stripes"));
   } else if (props["dbname"] == "redis") {
-    int port = stoi(props["port"]);
-    int slaves = stoi(props["slaves"]);
-    return new RedisDB(props["host"].c_str(), port, slaves);
+    return new RedisDB(props);
+  } else if (props["dbname"] == "redis_async") {
+    return new RedisAsyncDB(props);
   } else if (props["dbname"] == "rocksdb") {
     return new RocksDB(props, preloaded);
   } else if (props["dbname"] == "splinterdb") {
     return new SplinterDB(props, preloaded);
+  } else if (props["dbname"] == "sharded") {
+    return new ShardedDB(props, preloaded);
   } else if (props["dbname"] == "tbb_rand") {
     assert(!preloaded);
     return new TbbRandDB;
@@ -31,6 +31,12 @@ class LockStlDB : public HashtableDB {
   }
 
  protected:
+  ///
+  /// For hashtables of keys other than the LockStlHashtable, with records
+  /// kept the same way.
+  ///
+  LockStlDB(KeyHashtable *table) : HashtableDB(table) { }
+
   HashtableDB::FieldHashtable *NewFieldHashtable() {
     return new vmp::LockStlHashtable<const char *>;
   }
@@ -0,0 +1,235 @@
+//
+//  record_codec.h
+//  YCSB-C
+//
+//  Encoding of a multi-field record into a single value, for key-value
+//  backends. A record is a 16-bit field count followed by the fields, each
+//  a 16-bit name length, a 32-bit value length, the name and the value.
+//  Integers are in host byte order.
+//
+//  A partial update is encoded as a record made of the updated fields.
+//
+
+#ifndef YCSB_C_RECORD_CODEC_H_
+#define YCSB_C_RECORD_CODEC_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "core/db.h"
+
+namespace ycsbc {
+
+class RecordCodec {
+ public:
+  ///
+  /// A field of an encoded record, pointing into the record.
+  ///
+  struct Field {
+    const char *name;
+    size_t name_len;
+    const char *value;
+    size_t value_len;
+
+    bool NameIs(const std::string &other) const {
+      return other.size() == name_len && memcmp(other.data(), name, name_len) == 0;
+    }
+  };
+
+  ///
+  /// Iterates over the fields of an encoded record without copying them.
+  ///
+  class Reader {
+   public:
+    Reader(const char *data, size_t size) : pos_(data), end_(data + size), remaining_(0) {
+      if (size >= sizeof(uint16_t)) {
+        remaining_ = Load16(pos_);
+        pos_ += sizeof(uint16_t);
+      }
+    }
+
+    uint16_t NumFields() const { return remaining_; }
+
+    bool Next(Field *field) {
+      if (remaining_ == 0 || pos_ + kFieldHeaderSize > end_) {
+        return false;
+      }
+      field->name_len = Load16(pos_);
+      field->value_len = Load32(pos_ + sizeof(uint16_t));
+      field->name = pos_ + kFieldHeaderSize;
+      field->value = field->name + field->name_len;
+      if (field->value + field->value_len > end_) {
+        return false;
+      }
+      pos_ = field->value + field->value_len;
+      remaining_--;
+      return true;
+    }
+
+   private:
+    const char *pos_;
+    const char *end_;
+    uint16_t remaining_;
+  };
+
+  static size_t EncodedSize(const std::vector<DB::KVPair> &values) {
+    size_t size = sizeof(uint16_t);
+    for (const DB::KVPair &pair : values) {
+      size += kFieldHeaderSize + pair.first.size() + pair.second.size();
+    }
+    return size;
+  }
+
+  ///
+  /// Encodes the fields into record, replacing its contents but reusing
+  /// its capacity.
+  ///
+  static void Encode(const std::vector<DB::KVPair> &values, std::string &record) {
+    assert(values.size() <= UINT16_MAX);
+    record.clear();
+    record.reserve(EncodedSize(values));
+    Append16(record, values.size());
+    for (const DB::KVPair &pair : values) {
+      AppendField(record, pair.first.data(), pair.first.size(),
+                  pair.second.data(), pair.second.size());
+    }
+  }
+
+  ///
+  /// Decodes the given fields of a record, or all of them if fields is NULL.
+  ///
+  static void Decode(const char *data, size_t size,
+                     const std::vector<std::string> *fields,
+                     std::vector<DB::KVPair> &result) {
+    Reader reader(data, size);
+    Field field;
+    while (reader.Next(&field)) {
+      if (fields && !Contains(*fields, field)) {
+        continue;
+      }
+      result.emplace_back(std::string(field.name, field.name_len),
+                          std::string(field.value, field.value_len));
+    }
+  }
+
+  ///
+  /// Applies an encoded update to an encoded record: fields of the update
+  /// replace those of the record with the same name, and new fields are
+  /// appended. The result goes to out, which must not alias the inputs.
+  ///
+  static void Merge(const char *record, size_t record_size,
+                    const char *update, size_t update_size,
+                    std::string &out) {
+    Reader record_reader(record, record_size);
+    Reader update_reader(update, update_size);
+    out.clear();
+    out.reserve(record_size + update_size);
+    Append16(out, 0);
+    uint16_t count = 0;
+
+    Field field, updated;
+    while (record_reader.Next(&field)) {
+      bool found = Find(update, update_size, field.name, field.name_len, &updated);
+      const Field &source = found ? updated : field;
+      AppendField(out, source.name, source.name_len, source.value, source.value_len);
+      count++;
+    }
+    while (update_reader.Next(&updated)) {
+      if (!Find(record, record_size, updated.name, updated.name_len, &field)) {
+        AppendField(out, updated.name, updated.name_len, updated.value, updated.value_len);
+        count++;
+      }
+    }
+    memcpy(&out[0], &count, sizeof(count));
+  }
+
+  ///
+  /// Overwrites fields of an encoded record in place. Returns false and
+  /// leaves the record unchanged unless every field is present in the
+  /// record with a value of the same length.
+  ///
+  static bool Patch(char *record, size_t size, const std::vector<DB::KVPair> &values) {
+    Field field;
+    for (const DB::KVPair &pair : values) {
+      if (!Find(record, size, pair.first.data(), pair.first.size(), &field) ||
+          field.value_len != pair.second.size()) {
+        return false;
+      }
+    }
+    for (const DB::KVPair &pair : values) {
+      Find(record, size, pair.first.data(), pair.first.size(), &field);
+      memcpy(const_cast<char *>(field.value), pair.second.data(), field.value_len);
+    }
+    return true;
+  }
+
+  ///
+  /// Writes fields into an encoded record, in place if possible.
+  ///
+  static void Apply(std::string &record, const std::vector<DB::KVPair> &values) {
+    if (Patch(&record[0], record.size(), values)) {
+      return;
+    }
+    std::string update, merged;
+    Encode(values, update);
+    Merge(record.data(), record.size(), update.data(), update.size(), merged);
+    record.swap(merged);
+  }
+
+ private:
+  static const size_t kFieldHeaderSize = sizeof(uint16_t) + sizeof(uint32_t);
+
+  static uint16_t Load16(const char *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static uint32_t Load32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  static void Append16(std::string &out, uint16_t v) {
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+  }
+
+  static void AppendField(std::string &out, const char *name, size_t name_len,
+                          const char *value, size_t value_len) {
+    assert(name_len <= UINT16_MAX && value_len <= UINT32_MAX);
+    uint16_t n = name_len;
+    uint32_t v = value_len;
+    out.append(reinterpret_cast<const char *>(&n), sizeof(n));
+    out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+    out.append(name, name_len);
+    out.append(value, value_len);
+  }
+
+  ///
+  /// Finds the field of a record with the given name.
+  ///
+  static bool Find(const char *data, size_t size, const char *name, size_t name_len,
+                   Field *found) {
+    Reader reader(data, size);
+    while (reader.Next(found)) {
+      if (found->name_len == name_len && memcmp(found->name, name, name_len) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static bool Contains(const std::vector<std::string> &fields, const Field &field) {
+    for (const std::string &name : fields) {
+      if (field.NameIs(name)) return true;
+    }
+    return false;
+  }
+};
+
+} // ycsbc
+
+#endif // YCSB_C_RECORD_CODEC_H_
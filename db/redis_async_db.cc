@@ -0,0 +1,231 @@
+//
+//  redis_async_db.cc
+//  YCSB-C
+//
+
+#include "db/redis_async_db.h"
+#include "db/redis_db.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include "core/utils.h"
+
+using namespace std;
+
+namespace ycsbc {
+
+thread_local std::unordered_map<const RedisAsyncDB *, RedisAsyncDB::ThreadState *>
+    RedisAsyncDB::thread_states_;
+thread_local const RedisAsyncDB *RedisAsyncDB::cached_owner_ = NULL;
+thread_local RedisAsyncDB::ThreadState *RedisAsyncDB::cached_state_ = NULL;
+
+static uint64_t ElapsedNs(chrono::steady_clock::time_point start) {
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+RedisAsyncDB::RedisAsyncDB(const utils::Properties &props) :
+    host_(props.GetProperty("host", "127.0.0.1")),
+    port_(stoi(props.GetProperty("port", "6379"))),
+    slaves_(stoi(props.GetProperty("slaves", "0"))),
+    max_inflight_(stoul(props.GetProperty("redis.max_inflight", "0"))) {
+}
+
+void RedisAsyncDB::Init() {
+  ThreadState *state = new ThreadState;
+  state->context = redisAsyncConnect(host_.c_str(), port_);
+  if (!state->context || state->context->err) {
+    cerr << "Connect error: " << (state->context ? state->context->errstr : "can't allocate redis context!")
+         << endl;
+    exit(1);
+  }
+  state->loop.Attach(state->context);
+  // The connection completes in the loop, and a failure frees the context
+  // without calling OnDisconnect
+  redisAsyncSetConnectCallback(state->context, OnConnect);
+  redisAsyncSetDisconnectCallback(state->context, OnDisconnect);
+  state->slaves = slaves_;
+  thread_states_[this] = state;
+  cached_owner_ = this;
+  cached_state_ = state;
+}
+
+void RedisAsyncDB::Close() {
+  ThreadState *state = GetThreadState();
+  {
+    lock_guard<mutex> lock(stats_mutex);
+    read_ns.Merge(state->read_ns);
+    write_ns.Merge(state->write_ns);
+  }
+  // No command is in flight, so the context is freed right away
+  redisAsyncDisconnect(state->context);
+  delete state;
+  thread_states_.erase(this);
+  if (cached_owner_ == this) {
+    cached_owner_ = NULL;
+  }
+}
+
+void RedisAsyncDB::OnConnect(const redisAsyncContext *context, int status) {
+  if (status != REDIS_OK) {
+    cerr << "Connect error: " << context->errstr << endl;
+    exit(1);
+  }
+}
+
+void RedisAsyncDB::OnDisconnect(const redisAsyncContext *context, int status) {
+  if (status != REDIS_OK) {
+    cerr << "Redis error: " << context->errstr << endl;
+    exit(2);
+  }
+}
+
+void RedisAsyncDB::Send(ThreadState *state, size_t i) {
+  RedisArgs &args = state->args;
+  switch (state->command) {
+    case kRead:
+      RedisDB::BuildRead(args, state->keys[i], state->fields[i]);
+      break;
+    case kWrite:
+      RedisDB::BuildWrite(args, state->keys[i], state->values[i]);
+      break;
+    case kDelete:
+      args.Clear();
+      args.Add("DEL").Add(state->keys[i]);
+      break;
+  }
+  Request &request = state->requests[i];
+  request.state = state;
+  request.index = i;
+  request.sent = Clock::now();
+  redisAsyncCommandArgv(state->context, OnReply, &request, args.argc(), args.argv(),
+                        args.argvlen());
+}
+
+void RedisAsyncDB::OnReply(redisAsyncContext *context, void *reply, void *privdata) {
+  if (!reply) {
+    // The connection failed, and OnConnect or OnDisconnect exits
+    return;
+  }
+  Request *request = static_cast<Request *>(privdata);
+  ThreadState *state = request->state;
+  size_t i = request->index;
+  if (state->command == kRead) {
+    state->read_ns.Record(ElapsedNs(request->sent));
+    RedisDB::ParseRead(static_cast<redisReply *>(reply), state->fields[i], state->results[i]);
+  } else if (!state->slaves) {
+    state->write_ns.Record(ElapsedNs(request->sent));
+  }
+  state->replies++;
+  if (state->next < state->count) {
+    Send(state, state->next++);
+  }
+}
+
+void RedisAsyncDB::OnWait(redisAsyncContext *context, void *reply, void *privdata) {
+  static_cast<ThreadState *>(privdata)->waited = true;
+}
+
+void RedisAsyncDB::RunLoop(ThreadState *state) {
+  if (!state->loop.RunOnce()) {
+    cerr << "Redis error: connection lost with " << state->count - state->replies
+         << " replies pending" << endl;
+    exit(2);
+  }
+}
+
+void RedisAsyncDB::Run(ThreadState *state, Command command, size_t count) {
+  state->command = command;
+  state->count = count;
+  state->next = 0;
+  state->replies = 0;
+  // Requests are passed to callbacks, so they must not move while in flight
+  state->requests.resize(count);
+  size_t window = max_inflight_ > 0 ? min(max_inflight_, count) : count;
+  while (state->next < window) {
+    Send(state, state->next++);
+  }
+  while (state->replies < count) {
+    RunLoop(state);
+  }
+  if (slaves_ && command != kRead) {
+    // The writes are acknowledged by the slaves together
+    state->waited = false;
+    redisAsyncCommand(state->context, OnWait, state, "WAIT %d %d", slaves_, 0);
+    while (!state->waited) {
+      RunLoop(state);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      state->write_ns.Record(ElapsedNs(state->requests[i].sent));
+    }
+  }
+}
+
+int RedisAsyncDB::Read(const string &table, const string &key,
+                       const vector<string> *fields, vector<KVPair> &result) {
+  ThreadState *state = GetThreadState();
+  state->keys = &key;
+  state->fields = &fields;
+  state->results = &result;
+  Run(state, kRead, 1);
+  return DB::kOK;
+}
+
+int RedisAsyncDB::Scan(const string &table, const string &key, int len,
+                       const vector<string> *fields, vector<vector<KVPair>> &result) {
+  throw utils::Exception("redis_async does not support scans; use redis with redis.scan_index");
+}
+
+int RedisAsyncDB::Update(const string &table, const string &key, vector<KVPair> &values) {
+  ThreadState *state = GetThreadState();
+  state->keys = &key;
+  state->values = &values;
+  Run(state, kWrite, 1);
+  return DB::kOK;
+}
+
+int RedisAsyncDB::Delete(const string &table, const string &key) {
+  ThreadState *state = GetThreadState();
+  state->keys = &key;
+  Run(state, kDelete, 1);
+  return DB::kOK;
+}
+
+void RedisAsyncDB::BatchRead(const string &table, const vector<string> &keys,
+                             const vector<const vector<string> *> &fields,
+                             vector<vector<KVPair>> &results,
+                             vector<int> &statuses) {
+  ThreadState *state = GetThreadState();
+  results.resize(keys.size());
+  statuses.assign(keys.size(), int(DB::kOK));
+  state->keys = keys.data();
+  state->fields = fields.data();
+  state->results = results.data();
+  Run(state, kRead, keys.size());
+}
+
+void RedisAsyncDB::BatchUpdate(const string &table, const vector<string> &keys,
+                               vector<vector<KVPair>> &values,
+                               vector<int> &statuses) {
+  ThreadState *state = GetThreadState();
+  statuses.assign(keys.size(), int(DB::kOK));
+  state->keys = keys.data();
+  state->values = values.data();
+  Run(state, kWrite, keys.size());
+}
+
+void RedisAsyncDB::PrintStats(std::ostream &out) {
+  lock_guard<mutex> lock(stats_mutex);
+  if (read_ns.Count() > 0 || write_ns.Count() > 0) {
+    out << "# Redis async latency (us): count avg p50 p99 p99.9 max" << endl;
+    out << "read\t" << read_ns.Count() << '\t';
+    read_ns.PrintSummary(out, 1000);
+    out << endl << "write\t" << write_ns.Count() << '\t';
+    write_ns.PrintSummary(out, 1000);
+    out << endl;
+  }
+  read_ns.Reset();
+  write_ns.Reset();
+}
+
+} // namespace ycsbc
@@ -0,0 +1,154 @@
+//
+//  redis_async_db.h
+//  YCSB-C
+//
+//  Redis through the hiredis async API. Each client thread has its own
+//  connection and event loop, and keeps up to redis.max_inflight commands of
+//  a batch in flight, sending the next one as each reply arrives.
+//
+
+#ifndef YCSB_C_REDIS_ASYNC_DB_H_
+#define YCSB_C_REDIS_ASYNC_DB_H_
+
+#include "core/db.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/histogram.h"
+#include "core/properties.h"
+#include "redis/redis_client.h"
+#include "redis/redis_poll_loop.h"
+#include "redis/hiredis/async.h"
+
+namespace ycsbc {
+
+class RedisAsyncDB : public DB {
+ public:
+  RedisAsyncDB(const utils::Properties &props);
+
+  void Init();
+  void Close();
+
+  int Read(const std::string &table, const std::string &key,
+           const std::vector<std::string> *fields,
+           std::vector<KVPair> &result);
+
+  int Scan(const std::string &table, const std::string &key,
+           int len, const std::vector<std::string> *fields,
+           std::vector<std::vector<KVPair>> &result);
+
+  int Update(const std::string &table, const std::string &key,
+             std::vector<KVPair> &values);
+
+  int Insert(const std::string &table, const std::string &key,
+             std::vector<KVPair> &values) {
+    return Update(table, key, values);
+  }
+
+  int Delete(const std::string &table, const std::string &key);
+
+  void BatchRead(const std::string &table, const std::vector<std::string> &keys,
+                 const std::vector<const std::vector<std::string> *> &fields,
+                 std::vector<std::vector<KVPair>> &results,
+                 std::vector<int> &statuses);
+
+  void BatchUpdate(const std::string &table, const std::vector<std::string> &keys,
+                   std::vector<std::vector<KVPair>> &values,
+                   std::vector<int> &statuses);
+
+  void BatchInsert(const std::string &table, const std::vector<std::string> &keys,
+                   std::vector<std::vector<KVPair>> &values,
+                   std::vector<int> &statuses) {
+    BatchUpdate(table, keys, values, statuses);
+  }
+
+  void PrintStats(std::ostream &out);
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  enum Command { kRead, kWrite, kDelete };
+
+  struct ThreadState;
+
+  ///
+  /// A command in flight, passed to its reply callback.
+  ///
+  struct Request {
+    ThreadState *state;
+    size_t index;
+    Clock::time_point sent;
+  };
+
+  ///
+  /// State of a client thread, set up by Init(). The operations in
+  /// progress point into the arguments of the DB call running them.
+  ///
+  struct ThreadState {
+    redisAsyncContext                     *context;
+    RedisPollLoop                         loop;
+    RedisArgs                             args;
+    int                                   slaves;
+    std::vector<Request>                  requests; /// Of the operations in progress
+    Command                               command;
+    const std::string                     *keys;
+    const std::vector<std::string> *const *fields;
+    std::vector<KVPair>                   *results;
+    const std::vector<KVPair>             *values;
+    size_t                                count;
+    size_t                                next;    /// Operations sent
+    size_t                                replies; /// Operations done
+    bool                                  waited;  /// For the slaves
+    utils::Histogram                      read_ns;  /// From sending a command to its reply
+    utils::Histogram                      write_ns;
+  };
+
+  ///
+  /// Runs count operations of the thread, keeping up to max_inflight
+  /// commands in flight, then waits for the slaves after writes.
+  ///
+  void Run(ThreadState *state, Command command, size_t count);
+
+  static void Send(ThreadState *state, size_t i);
+  static void OnReply(redisAsyncContext *context, void *reply, void *privdata);
+  static void OnWait(redisAsyncContext *context, void *reply, void *privdata);
+  static void OnConnect(const redisAsyncContext *context, int status);
+  static void OnDisconnect(const redisAsyncContext *context, int status);
+
+  ///
+  /// Handles the events of the loop once, exiting if the connection is gone.
+  ///
+  static void RunLoop(ThreadState *state);
+
+  ///
+  /// The state of the calling thread, looked up in thread_states_ only when
+  /// the thread last used another instance.
+  ///
+  ThreadState *GetThreadState() {
+    if (cached_owner_ != this) {
+      cached_state_ = thread_states_.at(this);
+      cached_owner_ = this;
+    }
+    return cached_state_;
+  }
+
+  static thread_local std::unordered_map<const RedisAsyncDB *, ThreadState *> thread_states_;
+  static thread_local const RedisAsyncDB *cached_owner_;
+  static thread_local ThreadState *cached_state_;
+
+  const std::string host_;
+  const int port_;
+  const int slaves_;
+  const size_t max_inflight_; /// Or 0 for whole batches
+
+  std::mutex stats_mutex; /// Guards the histograms below
+  utils::Histogram read_ns;
+  utils::Histogram write_ns;
+};
+
+} // ycsbc
+
+#endif // YCSB_C_REDIS_ASYNC_DB_H_
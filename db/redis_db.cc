@@ -5,70 +5,413 @@
 
 #include "redis_db.h"
 
+#include <algorithm>
 #include <cstring>
 
 using namespace std;
 
 namespace ycsbc {
 
-int RedisDB::Read(const string &table, const string &key,
-         const vector<string> *fields,
-         vector<KVPair> &result) {
+thread_local std::unordered_map<const RedisDB *, RedisDB::ThreadState *> RedisDB::thread_states_;
+thread_local const RedisDB *RedisDB::cached_owner_ = NULL;
+thread_local RedisDB::ThreadState *RedisDB::cached_state_ = NULL;
+
+static uint64_t ElapsedNs(chrono::steady_clock::time_point start) {
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+///
+/// Reads the records of up to ARGV[2] keys of the index KEYS[1], from
+/// ARGV[1] on: the fields ARGV[3]... of each, or all of them.
+///
+static const char *kScanScript =
+    "local keys = redis.call('ZRANGEBYLEX', KEYS[1], '[' .. ARGV[1], '+', 'LIMIT', 0, ARGV[2])\n"
+    "local records = {}\n"
+    "for i, key in ipairs(keys) do\n"
+    "  if #ARGV > 2 then\n"
+    "    records[i] = redis.call('HMGET', key, unpack(ARGV, 3))\n"
+    "  else\n"
+    "    records[i] = redis.call('HGETALL', key)\n"
+    "  end\n"
+    "end\n"
+    "return records\n";
+
+RedisDB::RedisDB(const utils::Properties &props) :
+    router_(props.GetProperty("redis.endpoints", ""), props.GetProperty("host", "127.0.0.1"),
+            stoi(props.GetProperty("port", "6379")), props.GetProperty("redis.routing", "hash"),
+            stoi(props.GetProperty("redis.vnodes", "160"))),
+    slaves_(stoi(props.GetProperty("slaves", "0"))),
+    pipeline_depth_(stoi(props.GetProperty("redis.pipeline_depth", "0"))),
+    scan_index_(stoi(props.GetProperty("redis.scan_index", "0"))),
+    scan_script_(stoi(props.GetProperty("redis.scan_script", "0"))),
+    shards_(router_.NumEndpoints()) {
+  if (scan_script_ && !scan_index_) {
+    throw utils::Exception("redis.scan_script needs redis.scan_index");
+  }
+  if (scan_script_ && router_.NumEndpoints() > 1) {
+    // The script reads records from the server it runs on only
+    throw utils::Exception("redis.scan_script needs a single endpoint");
+  }
+}
+
+void RedisDB::Init() {
+  ThreadState *state = new ThreadState(router_, slaves_);
+  thread_states_[this] = state;
+  cached_owner_ = this;
+  cached_state_ = state;
+  if (scan_script_) {
+    state->args.Clear();
+    state->args.Add("SCRIPT").Add("LOAD").Add(kScanScript);
+    state->clients[0]->Append(state->args);
+    redisReply *reply = state->clients[0]->GetReply("SCRIPT LOAD");
+    assert(reply->type == REDIS_REPLY_STRING);
+    state->scan_sha.assign(reply->str, reply->len);
+    freeReplyObject(reply);
+  }
+}
+
+void RedisDB::Close() {
+  ThreadState *state = GetThreadState();
+  {
+    lock_guard<mutex> lock(stats_mutex);
+    read_ns.Merge(state->read_ns);
+    write_ns.Merge(state->write_ns);
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      shards_[i].Merge(state->shards[i]);
+    }
+  }
+  delete state;
+  thread_states_.erase(this);
+  if (cached_owner_ == this) {
+    cached_owner_ = NULL;
+  }
+}
+
+void RedisDB::BuildRead(RedisArgs &args, const string &key,
+                        const vector<string> *fields) {
+  args.Clear();
   if (fields) {
-    int argc = fields->size() + 2;
-    const char *argv[argc];
-    size_t argvlen[argc];
-    int i = 0;
-    argv[i] = "HMGET"; argvlen[i] = strlen(argv[i]);
-    argv[++i] = key.c_str(); argvlen[i] = key.length();
+    args.Add("HMGET").Add(key);
     for (const string &f : *fields) {
-      argv[++i] = f.data(); argvlen[i] = f.size();
+      args.Add(f);
     }
-    assert(i == argc - 1);
-    redisReply *reply = (redisReply *)redisCommandArgv(
-        redis_.context(), argc, argv, argvlen);
-    if (!reply) return DB::kOK;
-    assert(reply->type == REDIS_REPLY_ARRAY);
+  } else {
+    args.Add("HGETALL").Add(key);
+  }
+}
+
+void RedisDB::ParseRead(const redisReply *reply, const vector<string> *fields,
+                        vector<KVPair> &result) {
+  assert(reply->type == REDIS_REPLY_ARRAY);
+  if (fields) {
     assert(fields->size() == reply->elements);
     for (size_t i = 0; i < reply->elements; ++i) {
-      const char *value = reply->element[i]->str;
-      result.push_back(make_pair(fields->at(i), string(value ? value : "")));
+      // Missing fields are nil, with no string
+      const redisReply *value = reply->element[i];
+      result.emplace_back(fields->at(i), value->str ? string(value->str, value->len) : "");
     }
-    freeReplyObject(reply);
   } else {
-    redisReply *reply = (redisReply *)redisCommand(redis_.context(),
-        "HGETALL %s", key.c_str());
-    if (!reply) return DB::kOK;
-    assert(reply->type == REDIS_REPLY_ARRAY);
     for (size_t i = 0; i < reply->elements / 2; ++i) {
-      result.push_back(make_pair(
-          string(reply->element[2 * i]->str),
-          string(reply->element[2 * i + 1]->str)));
+      const redisReply *name = reply->element[2 * i];
+      const redisReply *value = reply->element[2 * i + 1];
+      result.emplace_back(string(name->str, name->len), string(value->str, value->len));
+    }
+  }
+}
+
+void RedisDB::BuildIndex(ThreadState *state, const char *command, const string &table,
+                         const string &key) {
+  state->index.assign(table).append(":index");
+  RedisArgs &args = state->args;
+  args.Clear();
+  args.Add(command).Add(state->index);
+  if (strcmp(command, "ZADD") == 0) {
+    // Members of equal scores are sorted by key
+    args.Add("0");
+  }
+  args.Add(key);
+}
+
+void RedisDB::BuildWrite(RedisArgs &args, const string &key,
+                         const vector<KVPair> &values) {
+  args.Clear();
+  args.Add("HMSET").Add(key);
+  for (const KVPair &p : values) {
+    args.Add(p.first).Add(p.second);
+  }
+}
+
+int RedisDB::Read(const string &table, const string &key,
+         const vector<string> *fields,
+         vector<KVPair> &result) {
+  ThreadState *state = GetThreadState();
+  BuildRead(state->args, key, fields);
+  RedisClient &client = ClientOf(state, key, false);
+  client.Append(state->args);
+  redisReply *reply = client.GetReply(state->args.argv()[0]);
+  ParseRead(reply, fields, result);
+  freeReplyObject(reply);
+  return DB::kOK;
+}
+
+int RedisDB::Scan(const string &table, const string &key, int len,
+                  const vector<string> *fields, vector<vector<KVPair>> &result) {
+  if (!scan_index_) {
+    throw utils::Exception("Redis scans need redis.scan_index");
+  }
+  ThreadState *state = GetThreadState();
+  if (scan_script_) {
+    ScanScript(state, table, key, len, fields, result);
+    return DB::kOK;
+  }
+  state->index.assign(table).append(":index");
+  state->scan_start.assign("[").append(key);
+  state->scan_len = to_string(len);
+  state->args.Clear();
+  state->args.Add("ZRANGEBYLEX").Add(state->index).Add(state->scan_start).Add("+")
+      .Add("LIMIT").Add("0").Add(state->scan_len);
+  for (unique_ptr<RedisClient> &client : state->clients) {
+    client->Append(state->args);
+  }
+  state->scan_keys.clear();
+  for (unique_ptr<RedisClient> &client : state->clients) {
+    redisReply *reply = client->GetReply("ZRANGEBYLEX");
+    assert(reply->type == REDIS_REPLY_ARRAY);
+    for (size_t i = 0; i < reply->elements; ++i) {
+      state->scan_keys.emplace_back(reply->element[i]->str, reply->element[i]->len);
     }
     freeReplyObject(reply);
   }
+  if (state->clients.size() > 1) {
+    // Each endpoint returned its own first keys, of which the scan takes
+    // the first len
+    sort(state->scan_keys.begin(), state->scan_keys.end());
+    if (state->scan_keys.size() > (size_t)len) {
+      state->scan_keys.resize(len);
+    }
+  }
+
+  // The records are read in a single pipelined round
+  state->routes.resize(state->scan_keys.size());
+  for (size_t i = 0; i < state->scan_keys.size(); ++i) {
+    BuildRead(state->args, state->scan_keys[i], fields);
+    state->routes[i] = Route(state, state->scan_keys[i], false);
+    state->clients[state->routes[i]]->Append(state->args);
+  }
+  for (size_t i = 0; i < state->scan_keys.size(); ++i) {
+    redisReply *reply = state->clients[state->routes[i]]->GetReply(fields ? "HMGET" : "HGETALL");
+    result.emplace_back();
+    ParseRead(reply, fields, result.back());
+    freeReplyObject(reply);
+  }
+  return DB::kOK;
+}
+
+void RedisDB::ScanScript(ThreadState *state, const string &table, const string &key,
+                         int len, const vector<string> *fields,
+                         vector<vector<KVPair>> &result) {
+  state->index.assign(table).append(":index");
+  state->scan_len = to_string(len);
+  RedisArgs &args = state->args;
+  args.Clear();
+  args.Add("EVALSHA").Add(state->scan_sha).Add("1").Add(state->index).Add(key)
+      .Add(state->scan_len);
+  if (fields) {
+    for (const string &f : *fields) {
+      args.Add(f);
+    }
+  }
+  state->clients[0]->Append(args);
+  redisReply *reply = state->clients[0]->GetReply("EVALSHA");
+  assert(reply->type == REDIS_REPLY_ARRAY);
+  for (size_t i = 0; i < reply->elements; ++i) {
+    result.emplace_back();
+    ParseRead(reply->element[i], fields, result.back());
+  }
+  freeReplyObject(reply);
+}
+
+int RedisDB::Insert(const string &table, const string &key, vector<KVPair> &values) {
+  if (!scan_index_) {
+    return Update(table, key, values);
+  }
+  ThreadState *state = GetThreadState();
+  RedisClient &client = ClientOf(state, key, true);
+  BuildWrite(state->args, key, values);
+  client.Append(state->args);
+  BuildIndex(state, "ZADD", table, key);
+  client.Append(state->args);
+  bool wait = client.AppendWait();
+  freeReplyObject(client.GetReply("HMSET"));
+  freeReplyObject(client.GetReply("ZADD"));
+  if (wait) {
+    freeReplyObject(client.GetReply("WAIT"));
+  }
   return DB::kOK;
 }
 
 int RedisDB::Update(const string &table, const string &key,
            vector<KVPair> &values) {
-  string cmd("HMSET");
-  size_t len = cmd.length() + key.length() + 1;
-  for (KVPair &p : values) {
-    len += p.first.length() + p.second.length() + 2;
-  }
-  cmd.reserve(len);
-
-  cmd.append(" ").append(key);
-  for (KVPair &p : values) {
-    assert(p.first.find(' ') == string::npos);
-    cmd.append(" ").append(p.first);
-    assert(p.second.find(' ') == string::npos);
-    cmd.append(" ").append(p.second);
-  }
-  assert(cmd.length() == len);
-  redis_.Command(cmd);
+  ThreadState *state = GetThreadState();
+  BuildWrite(state->args, key, values);
+  ClientOf(state, key, true).Command(state->args);
+  return DB::kOK;
+}
+
+int RedisDB::Delete(const string &table, const string &key) {
+  ThreadState *state = GetThreadState();
+  state->args.Clear();
+  state->args.Add("DEL").Add(key);
+  RedisClient &client = ClientOf(state, key, true);
+  if (!scan_index_) {
+    client.Command(state->args);
+    return DB::kOK;
+  }
+  client.Append(state->args);
+  BuildIndex(state, "ZREM", table, key);
+  client.Append(state->args);
+  bool wait = client.AppendWait();
+  freeReplyObject(client.GetReply("DEL"));
+  freeReplyObject(client.GetReply("ZREM"));
+  if (wait) {
+    freeReplyObject(client.GetReply("WAIT"));
+  }
   return DB::kOK;
 }
 
+void RedisDB::BatchRead(const string &table, const vector<string> &keys,
+                        const vector<const vector<string> *> &fields,
+                        vector<vector<KVPair>> &results,
+                        vector<int> &statuses) {
+  ThreadState *state = GetThreadState();
+  size_t depth = pipeline_depth_ > 0 ? pipeline_depth_ : keys.size();
+  results.resize(keys.size());
+  statuses.assign(keys.size(), int(DB::kOK));
+  for (size_t start = 0; start < keys.size(); start += depth) {
+    size_t end = min(keys.size(), start + depth);
+    state->sent.resize(end - start);
+    state->routes.resize(end - start);
+    for (size_t i = start; i < end; ++i) {
+      BuildRead(state->args, keys[i], fields[i]);
+      size_t shard = state->routes[i - start] = Route(state, keys[i], false);
+      state->clients[shard]->Append(state->args);
+      state->sent[i - start] = Clock::now();
+    }
+    // Replies come in order on each connection, so reading them in the
+    // order of the keys waits on one endpoint at a time
+    for (size_t i = start; i < end; ++i) {
+      size_t shard = state->routes[i - start];
+      redisReply *reply = state->clients[shard]->GetReply(fields[i] ? "HMGET" : "HGETALL");
+      uint64_t ns = ElapsedNs(state->sent[i - start]);
+      state->read_ns.Record(ns);
+      state->shards[shard].pipelined_ns.Record(ns);
+      ParseRead(reply, fields[i], results[i]);
+      freeReplyObject(reply);
+    }
+  }
+}
+
+void RedisDB::BatchWrite(const string &table, const vector<string> &keys,
+                         vector<vector<KVPair>> &values,
+                         vector<int> &statuses, bool index) {
+  ThreadState *state = GetThreadState();
+  size_t depth = pipeline_depth_ > 0 ? pipeline_depth_ : keys.size();
+  statuses.assign(keys.size(), int(DB::kOK));
+  for (size_t start = 0; start < keys.size(); start += depth) {
+    size_t end = min(keys.size(), start + depth);
+    state->sent.resize(end - start);
+    state->routes.resize(end - start);
+    state->waits.assign(state->clients.size(), false);
+    for (size_t i = start; i < end; ++i) {
+      size_t shard = state->routes[i - start] = Route(state, keys[i], true);
+      RedisClient &client = *state->clients[shard];
+      BuildWrite(state->args, keys[i], values[i]);
+      client.Append(state->args);
+      if (index) {
+        BuildIndex(state, "ZADD", table, keys[i]);
+        client.Append(state->args);
+      }
+      state->waits[shard] = true;
+      state->sent[i - start] = Clock::now();
+    }
+    // The writes of a round are acknowledged by the slaves together
+    bool wait = AppendWaits(state);
+    for (size_t i = start; i < end; ++i) {
+      RedisClient &client = *state->clients[state->routes[i - start]];
+      freeReplyObject(client.GetReply("HMSET"));
+      if (index) {
+        freeReplyObject(client.GetReply("ZADD"));
+      }
+      if (!wait) {
+        RecordWrite(state, i - start);
+      }
+    }
+    if (wait) {
+      GetWaits(state);
+      for (size_t i = start; i < end; ++i) {
+        RecordWrite(state, i - start);
+      }
+    }
+  }
+}
+
+bool RedisDB::AppendWaits(ThreadState *state) {
+  bool any = false;
+  for (size_t i = 0; i < state->clients.size(); ++i) {
+    if (state->waits[i]) {
+      state->waits[i] = state->clients[i]->AppendWait();
+      any = any || state->waits[i];
+    }
+  }
+  return any;
+}
+
+void RedisDB::GetWaits(ThreadState *state) {
+  for (size_t i = 0; i < state->clients.size(); ++i) {
+    if (state->waits[i]) {
+      freeReplyObject(state->clients[i]->GetReply("WAIT"));
+    }
+  }
+}
+
+void RedisDB::RecordWrite(ThreadState *state, size_t i) {
+  uint64_t ns = ElapsedNs(state->sent[i]);
+  state->write_ns.Record(ns);
+  state->shards[state->routes[i]].pipelined_ns.Record(ns);
+}
+
+void RedisDB::PrintStats(std::ostream &out) {
+  lock_guard<mutex> lock(stats_mutex);
+  if (read_ns.Count() > 0 || write_ns.Count() > 0) {
+    out << "# Redis pipelined latency (us): count avg p50 p99 p99.9 max" << endl;
+    out << "read\t" << read_ns.Count() << '\t';
+    read_ns.PrintSummary(out, 1000);
+    out << endl << "write\t" << write_ns.Count() << '\t';
+    write_ns.PrintSummary(out, 1000);
+    out << endl;
+  }
+  read_ns.Reset();
+  write_ns.Reset();
+
+  uint64_t total = 0;
+  for (const ShardStats &shard : shards_) {
+    total += shard.reads + shard.writes;
+  }
+  if (shards_.size() > 1 && total > 0) {
+    out << "# Redis shards: endpoint reads writes share(%) "
+        << "pipelined (us): count avg p50 p99 p99.9 max" << endl;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      const ShardStats &shard = shards_[i];
+      out << router_.endpoint(i).name << '\t' << shard.reads << '\t' << shard.writes << '\t'
+          << 100.0 * (shard.reads + shard.writes) / total << '\t'
+          << shard.pipelined_ns.Count() << '\t';
+      shard.pipelined_ns.PrintSummary(out, 1000);
+      out << endl;
+    }
+  }
+  for (ShardStats &shard : shards_) {
+    shard = ShardStats();
+  }
+}
+
 } // namespace ycsbc
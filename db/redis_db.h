@@ -8,10 +8,18 @@
 
 #include "core/db.h"
 
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/histogram.h"
 #include "core/properties.h"
+#include "core/utils.h"
 #include "redis/redis_client.h"
+#include "redis/redis_router.h"
 #include "redis/hiredis/hiredis.h"
 
 using std::cout;
@@ -19,11 +27,27 @@ using std::endl;
 
 namespace ycsbc {
 
+///
+/// Each client thread connects to Redis in Init(), as a connection is not
+/// thread-safe. Batches are pipelined: up to pipeline_depth commands are
+/// sent before their replies are read, with a single WAIT for the slaves
+/// after the writes of each round.
+///
+/// Scans need redis.scan_index, which keeps the keys of each table in a
+/// sorted set, "<table>:index", with inserts and deletes.
+///
+/// With redis.endpoints, keys are sharded over several servers by a
+/// RedisRouter, each thread holding a connection to every server. A batch
+/// round appends each command to the connection of its key, so all the
+/// servers work on the round at once. Each server keeps the index of its
+/// own keys, and scans merge them.
+///
 class RedisDB : public DB {
  public:
-  RedisDB(const char *host, int port, int slaves) :
-      redis_(host, port, slaves) {
-  }
+  RedisDB(const utils::Properties &props);
+
+  void Init();
+  void Close();
 
   int Read(const std::string &table, const std::string &key,
            const std::vector<std::string> *fields,
@@ -31,29 +55,170 @@ class RedisDB : public DB {
 
   int Scan(const std::string &table, const std::string &key,
            int len, const std::vector<std::string> *fields,
-           std::vector<std::vector<KVPair>> &result) {
-    throw "Scan: function not implemented!";
-  }
+           std::vector<std::vector<KVPair>> &result);
 
   int Update(const std::string &table, const std::string &key,
              std::vector<KVPair> &values);
 
   int Insert(const std::string &table, const std::string &key,
-             std::vector<KVPair> &values) {
-    return Update(table, key, values);
+             std::vector<KVPair> &values);
+
+  int Delete(const std::string &table, const std::string &key);
+
+  void BatchRead(const std::string &table, const std::vector<std::string> &keys,
+                 const std::vector<const std::vector<std::string> *> &fields,
+                 std::vector<std::vector<KVPair>> &results,
+                 std::vector<int> &statuses);
+
+  void BatchUpdate(const std::string &table, const std::vector<std::string> &keys,
+                   std::vector<std::vector<KVPair>> &values,
+                   std::vector<int> &statuses) {
+    BatchWrite(table, keys, values, statuses, false);
   }
 
-  int Delete(const std::string &table, const std::string &key) {
-    std::string cmd("DEL " + key);
-    redis_.Command(cmd);
-    return DB::kOK;
+  void BatchInsert(const std::string &table, const std::vector<std::string> &keys,
+                   std::vector<std::vector<KVPair>> &values,
+                   std::vector<int> &statuses) {
+    BatchWrite(table, keys, values, statuses, scan_index_);
   }
 
+  void PrintStats(std::ostream &out);
+
+  ///
+  /// Builds the command reading a record, and parses its reply.
+  ///
+  static void BuildRead(RedisArgs &args, const std::string &key,
+                        const std::vector<std::string> *fields);
+  static void ParseRead(const redisReply *reply, const std::vector<std::string> *fields,
+                        std::vector<KVPair> &result);
+
+  ///
+  /// Builds the command writing the fields of a record.
+  ///
+  static void BuildWrite(RedisArgs &args, const std::string &key,
+                         const std::vector<KVPair> &values);
+
  private:
-  RedisClient redis_;
+  typedef std::chrono::steady_clock Clock;
+
+  ///
+  /// Operations sent to an endpoint, and the latency of those pipelined.
+  ///
+  struct ShardStats {
+    uint64_t         reads = 0;
+    uint64_t         writes = 0;
+    utils::Histogram pipelined_ns;
+
+    void Merge(const ShardStats &other) {
+      reads += other.reads;
+      writes += other.writes;
+      pipelined_ns.Merge(other.pipelined_ns);
+    }
+  };
+
+  ///
+  /// State of a client thread, set up by Init().
+  ///
+  struct ThreadState {
+    std::vector<std::unique_ptr<RedisClient>> clients; /// One per endpoint
+    std::vector<ShardStats>        shards;
+    std::vector<size_t>            routes; /// Endpoints of the keys of a round
+    std::vector<bool>              waits; /// Endpoints to wait for in a round
+    RedisArgs                      args; /// Of the command being built
+    std::string                    index; /// Key of the index being built
+    std::string                    scan_start;
+    std::string                    scan_len;
+    std::vector<std::string>       scan_keys;
+    std::string                    scan_sha; /// Of the scan script, if loaded
+    std::vector<Clock::time_point> sent; /// Of the commands in flight
+    utils::Histogram               read_ns;  /// From sending a command to its reply
+    utils::Histogram               write_ns;
+
+    ThreadState(const RedisRouter &router, int slaves) : shards(router.NumEndpoints()) {
+      for (size_t i = 0; i < router.NumEndpoints(); ++i) {
+        const RedisRouter::Endpoint &endpoint = router.endpoint(i);
+        clients.emplace_back(new RedisClient(endpoint.host.c_str(), endpoint.port, slaves));
+      }
+    }
+  };
+
+  ///
+  /// The state of the calling thread, looked up in thread_states_ only when
+  /// the thread last used another instance.
+  ///
+  ThreadState *GetThreadState() {
+    if (cached_owner_ != this) {
+      cached_state_ = thread_states_.at(this);
+      cached_owner_ = this;
+    }
+    return cached_state_;
+  }
+
+  ///
+  /// The endpoint of key, counting the operation.
+  ///
+  size_t Route(ThreadState *state, const std::string &key, bool write) {
+    size_t shard = router_.Route(key);
+    ShardStats &stats = state->shards[shard];
+    (write ? stats.writes : stats.reads)++;
+    return shard;
+  }
+
+  RedisClient &ClientOf(ThreadState *state, const std::string &key, bool write) {
+    return *state->clients[Route(state, key, write)];
+  }
+
+  ///
+  /// Appends a WAIT to each endpoint written to in the round, as marked in
+  /// state->waits. Returns whether any did.
+  ///
+  bool AppendWaits(ThreadState *state);
+  void GetWaits(ThreadState *state);
+
+  ///
+  /// Records the latency of the i-th write of a round.
+  ///
+  void RecordWrite(ThreadState *state, size_t i);
+
+  ///
+  /// Builds the command adding a key to, or removing it from, the index of
+  /// its table.
+  ///
+  void BuildIndex(ThreadState *state, const char *command, const std::string &table,
+                  const std::string &key);
+
+  ///
+  /// Writes records in pipelined rounds, adding their keys to the index if
+  /// index is set.
+  ///
+  void BatchWrite(const std::string &table, const std::vector<std::string> &keys,
+                  std::vector<std::vector<KVPair>> &values,
+                  std::vector<int> &statuses, bool index);
+
+  ///
+  /// Scans with a single call to a server-side script, which reads the
+  /// index and the records.
+  ///
+  void ScanScript(ThreadState *state, const std::string &table, const std::string &key,
+                  int len, const std::vector<std::string> *fields,
+                  std::vector<std::vector<KVPair>> &result);
+
+  static thread_local std::unordered_map<const RedisDB *, ThreadState *> thread_states_;
+  static thread_local const RedisDB *cached_owner_;
+  static thread_local ThreadState *cached_state_;
+
+  const RedisRouter router_;
+  const int slaves_;
+  const int pipeline_depth_; /// Commands in flight, or 0 for whole batches
+  const bool scan_index_;
+  const bool scan_script_; /// Scan with a Lua script, in one round trip
+
+  std::mutex stats_mutex; /// Guards the stats below
+  utils::Histogram read_ns;
+  utils::Histogram write_ns;
+  std::vector<ShardStats> shards_;
 };
 
 } // ycsbc
 
 #endif // YCSB_C_REDIS_DB_H_
-
@@ -7,9 +7,20 @@
 //
 
 #include "db/rocks_db.h"
+#include "db/record_codec.h"
+#include "db/scan_bound.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <rocksdb/convenience.h>
+#include <rocksdb/merge_operator.h>
+#include <rocksdb/perf_context.h>
+#include <rocksdb/slice_transform.h>
+#include <rocksdb/statistics.h>
+#include <rocksdb/sst_file_writer.h>
 #include <rocksdb/utilities/options_util.h>
 
 using std::string;
@@ -17,6 +28,39 @@ using std::vector;
 
 namespace ycsbc {
 
+thread_local std::unordered_map<const RocksDB *, RocksDB::ThreadState *>
+    RocksDB::thread_states_;
+thread_local const RocksDB *RocksDB::cached_owner_ = NULL;
+thread_local RocksDB::ThreadState *RocksDB::cached_state_ = NULL;
+
+typedef std::chrono::steady_clock Clock;
+
+static uint64_t ElapsedNs(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+///
+/// Applies field updates, encoded as partial records, to records. Merging
+/// two updates yields an update of the fields of both, so the operator is
+/// associative and compactions can combine updates on their own.
+///
+class RecordMergeOperator : public rocksdb::AssociativeMergeOperator {
+ public:
+  bool Merge(const rocksdb::Slice &key, const rocksdb::Slice *existing_value,
+             const rocksdb::Slice &value, std::string *new_value,
+             rocksdb::Logger *logger) const override {
+    if (!existing_value) {
+      new_value->assign(value.data(), value.size());
+    } else {
+      RecordCodec::Merge(existing_value->data(), existing_value->size(),
+                         value.data(), value.size(), *new_value);
+    }
+    return true;
+  }
+
+  const char *Name() const override { return "YCSBRecordMergeOperator"; }
+};
+
 void RocksDB::InitializeOptions(utils::Properties &props)
 {
   const std::map<std::string, std::string> &m = (const std::map<std::string, std::string> &)props;
@@ -39,6 +83,42 @@ void RocksDB::InitializeOptions(utils::Properties &props)
     } else if (tuple.first == "rocksdb.write_options.disableWAL") {
       long int disableWAL = props.GetIntProperty("rocksdb.write_options.disableWAL");
       woptions.disableWAL = disableWAL;
+    } else if (tuple.first == "rocksdb.merge_updates") {
+      merge_updates = props.GetIntProperty("rocksdb.merge_updates");
+    } else if (tuple.first == "rocksdb.statistics") {
+      if (props.GetIntProperty("rocksdb.statistics")) {
+        statistics = rocksdb::CreateDBStatistics();
+      }
+    } else if (tuple.first == "rocksdb.perf_sample_rate") {
+      perf_sample_rate = props.GetIntProperty("rocksdb.perf_sample_rate");
+    } else if (tuple.first == "rocksdb.bounded_scans") {
+      bounded_scans = props.GetIntProperty("rocksdb.bounded_scans");
+    } else if (tuple.first == "rocksdb.scan_readahead_kb") {
+      scan_options.readahead_size = props.GetIntProperty("rocksdb.scan_readahead_kb") << 10;
+    } else if (tuple.first == "rocksdb.scan_pin_data") {
+      scan_options.pin_data = props.GetIntProperty("rocksdb.scan_pin_data");
+    } else if (tuple.first == "rocksdb.prefix_length") {
+      prefix_length = props.GetIntProperty("rocksdb.prefix_length");
+    } else if (tuple.first == "rocksdb.transactions") {
+      transaction_mode = tuple.second;
+      if (transaction_mode != "none" && transaction_mode != "optimistic" &&
+          transaction_mode != "pessimistic") {
+        throw utils::Exception("Unknown rocksdb.transactions: " + transaction_mode);
+      }
+    } else if (tuple.first == "rocksdb.transaction_retries") {
+      transaction_retries = props.GetIntProperty("rocksdb.transaction_retries");
+    } else if (tuple.first == "rocksdb.transaction_lock_timeout_ms") {
+      txn_options.lock_timeout = props.GetIntProperty("rocksdb.transaction_lock_timeout_ms");
+    } else if (tuple.first == "rocksdb.bulk_load") {
+      bulk_loading = props.GetIntProperty("rocksdb.bulk_load");
+    } else if (tuple.first == "rocksdb.bulk_load_buffer_mb") {
+      bulk_buffer_bytes = props.GetIntProperty("rocksdb.bulk_load_buffer_mb") << 20;
+    } else if (tuple.first.find("rocksdb.cf.") == 0) {
+      // rocksdb.cf.<table>.<option>
+      auto name = tuple.first.substr(strlen("rocksdb.cf."));
+      size_t dot = name.find('.');
+      assert(dot != std::string::npos && dot > 0);
+      cf_options_maps[name.substr(0, dot)][name.substr(dot + 1)] = tuple.second;
     } else if (tuple.first == "rocksdb.config_file") {
       // ignore it here -- loaded above
     } else if (tuple.first == "rocksdb.database_filename") {
@@ -51,29 +131,144 @@ void RocksDB::InitializeOptions(utils::Properties &props)
   rocksdb::Options new_options;
   assert(GetDBOptionsFromMap(copts, options, options_map, &new_options) == rocksdb::Status::OK());
   options = new_options;
+
+  if (prefix_length > 0) {
+    // Column families inherit it, unless their options set their own
+    options.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(prefix_length));
+    // Scans cross prefixes, so the prefix filters only serve those that
+    // stay within the prefix of their upper bound
+    scan_options.auto_prefix_mode = true;
+  }
 }
 
-  RocksDB::RocksDB(utils::Properties &props, bool preloaded)
+  RocksDB::RocksDB(utils::Properties &props, bool preloaded) :
+  bounded_scans(false), prefix_length(0), merge_updates(false), perf_sample_rate(0),
+  transaction_mode("none"), optimistic_db(NULL), pessimistic_db(NULL), transaction_retries(0),
+  bulk_loading(false), bulk_buffer_bytes(256 << 20),
+  loading_threads(0), bulk_file_count(0), bulk_ingest_seconds(0), bulk_compact_seconds(0)
 {
   InitializeOptions(props);
+  // Every table of a multi-table workload gets a column family, with the
+  // base options unless rocksdb.cf.<table>.* overrides them
+  std::stringstream tables(props.GetProperty("tables"));
+  std::string table;
+  while (std::getline(tables, table, ',')) {
+    table = utils::Trim(table);
+    if (!table.empty()) {
+      cf_options_maps[table];
+    }
+  }
   std::string database_filename = props.GetProperty("rocksdb.database_filename");
+  bulk_loading = bulk_loading && !preloaded;
+  if (bulk_loading) {
+    // Every client thread of the Load phase closes before ingestion
+    loading_threads = props.GetIntProperty("threadcount");
+    bulk_dir = database_filename + ".bulk";
+    std::filesystem::create_directories(bulk_dir);
+    // The files of all threads are compacted at once: split the compaction
+    // by key range over as many threads as loaded them
+    options.max_subcompactions = std::max<uint32_t>(options.max_subcompactions,
+                                                    loading_threads);
+  }
+  options.statistics = statistics;
+  // Always set, for databases preloaded with merge_updates
+  options.merge_operator.reset(new RecordMergeOperator);
   options.create_if_missing = !preloaded;
   options.error_if_exists = !preloaded;
-  rocksdb::Status status = rocksdb::DB::Open(options, database_filename, &db);
+  Open(database_filename, preloaded);
+}
+
+void RocksDB::Open(const string &filename, bool preloaded)
+{
+  rocksdb::ConfigOptions copts;
+  std::map<string, rocksdb::ColumnFamilyOptions> cf_options;
+  cf_options[rocksdb::kDefaultColumnFamilyName] = options;
+  if (preloaded) {
+    vector<string> names;
+    rocksdb::Status status = rocksdb::DB::ListColumnFamilies(options, filename, &names);
+    assert(status.ok());
+    for (const string &name : names) {
+      cf_options[name] = options;
+    }
+  }
+  for (auto &table : cf_options_maps) {
+    rocksdb::Status status = GetColumnFamilyOptionsFromMap(copts, options, table.second,
+                                                           &cf_options[table.first]);
+    assert(status.ok());
+  }
+
+  for (auto &cf : cf_options) {
+    cf_descriptors.emplace_back(cf.first, cf.second);
+  }
+  options.create_missing_column_families = true;
+  rocksdb::Status status;
+  if (transaction_mode == "optimistic") {
+    status = rocksdb::OptimisticTransactionDB::Open(options, filename, cf_descriptors,
+                                                    &cf_handles, &optimistic_db);
+    db = optimistic_db;
+  } else if (transaction_mode == "pessimistic") {
+    status = rocksdb::TransactionDB::Open(options, rocksdb::TransactionDBOptions(), filename,
+                                          cf_descriptors, &cf_handles, &pessimistic_db);
+    db = pessimistic_db;
+  } else {
+    status = rocksdb::DB::Open(options, filename, cf_descriptors, &cf_handles, &db);
+  }
   assert(status.ok());
+  for (size_t i = 0; i < cf_handles.size(); ++i) {
+    if (cf_descriptors[i].name == rocksdb::kDefaultColumnFamilyName) {
+      default_cf = cf_handles[i];
+    } else {
+      column_families[cf_descriptors[i].name] = cf_handles[i];
+    }
+  }
 }
 
 RocksDB::~RocksDB()
 {
+  for (rocksdb::ColumnFamilyHandle *handle : cf_handles) {
+    db->DestroyColumnFamilyHandle(handle);
+  }
   delete db;
 }
 
 void RocksDB::Init()
 {
+  ThreadState *state = new ThreadState;
+  state->bulk_bytes = 0;
+  state->gets = 0;
+  thread_states_[this] = state;
+  cached_owner_ = this;
+  cached_state_ = state;
 }
 
 void RocksDB::Close()
 {
+  ThreadState *state = GetThreadState();
+  if (state->bulk_bytes > 0) {
+    WriteBulkFile(state);
+  }
+  {
+    std::lock_guard<std::mutex> lock(bulk_mutex);
+    if (bulk_loading && --loading_threads == 0) {
+      IngestBulkFiles();
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    read_batch_ns.Merge(state->read_batch_ns);
+    read_key_ns.Merge(state->read_key_ns);
+    update_batch_ns.Merge(state->update_batch_ns);
+    update_key_ns.Merge(state->update_key_ns);
+    insert_batch_ns.Merge(state->insert_batch_ns);
+    insert_key_ns.Merge(state->insert_key_ns);
+    get_breakdown.Merge(state->get_breakdown);
+    txn_counts.Merge(state->txn_counts);
+  }
+  delete state;
+  thread_states_.erase(this);
+  if (cached_owner_ == this) {
+    cached_owner_ = NULL;
+  }
 }
 
 int RocksDB::Read(const string &table,
@@ -81,9 +276,24 @@ int RocksDB::Read(const string &table,
                      const vector<string> *fields,
                      vector<KVPair> &result)
 {
-  string value;
-  rocksdb::Status status = db->Get(roptions, rocksdb::Slice(key), &value);
-  assert(status.ok() || status.IsNotFound()); // TODO is it expected we're querying non-existing keys?
+  ThreadState *state = GetThreadState();
+  bool sample = perf_sample_rate > 0 && ++state->gets % perf_sample_rate == 0;
+  Clock::time_point start;
+  if (sample) {
+    rocksdb::SetPerfLevel(rocksdb::kEnableTimeExceptForMutex);
+    rocksdb::get_perf_context()->Reset();
+    start = Clock::now();
+  }
+  rocksdb::PinnableSlice value;
+  rocksdb::Status status = db->Get(roptions, ColumnFamily(table), rocksdb::Slice(key), &value);
+  if (sample) {
+    SampleGet(state, ElapsedNs(start));
+  }
+  if (status.IsNotFound()) {
+    return DB::kErrorNoData;
+  }
+  assert(status.ok());
+  RecordCodec::Decode(value.data(), value.size(), fields, result);
   return DB::kOK;
 }
 
@@ -92,37 +302,539 @@ int RocksDB::Scan(const string &table,
                   const vector<string> *fields,
                   vector<vector<KVPair>> &result)
 {
-  rocksdb::Iterator* it = db->NewIterator(roptions);
+  ThreadState *state = GetThreadState();
+  bool bounded = bounded_scans && ScanUpperBound(key, len, state->scan_bound);
+  if (bounded) {
+    state->scan_bound_slice = rocksdb::Slice(state->scan_bound);
+  }
+  rocksdb::Iterator *it = ScanIterator(state, ColumnFamily(table), bounded);
   int i = 0;
   for (it->Seek(key); i < len && it->Valid(); it->Next()) {
+    rocksdb::Slice value = it->value();
+    result.emplace_back();
+    RecordCodec::Decode(value.data(), value.size(), fields, result.back());
     i++;
   }
-  delete it;
+  assert(it->status().ok());
   return DB::kOK;
 }
 
+rocksdb::Iterator *RocksDB::ScanIterator(ThreadState *state, rocksdb::ColumnFamilyHandle *cf,
+                                         bool bounded)
+{
+  auto &iterators = bounded ? state->bounded_iterators : state->iterators;
+  std::unique_ptr<rocksdb::Iterator> &it = iterators[cf];
+  if (!it) {
+    rocksdb::ReadOptions options = scan_options;
+    if (bounded) {
+      // Read at every seek, so the bound can change from scan to scan
+      options.iterate_upper_bound = &state->scan_bound_slice;
+    }
+    it.reset(db->NewIterator(options, cf));
+  } else {
+    rocksdb::Status status = it->Refresh();
+    assert(status.ok());
+  }
+  return it.get();
+}
+
 int RocksDB::Update(const string &table,
                     const string &key,
                     vector<KVPair> &values)
 {
-  return Insert(table, key, values);
+  static thread_local string record;
+  if (merge_updates) {
+    RecordCodec::Encode(values, record);
+    rocksdb::Status status = db->Merge(woptions, ColumnFamily(table), rocksdb::Slice(key),
+                                       rocksdb::Slice(record));
+    assert(status.ok());
+    return DB::kOK;
+  }
+  rocksdb::Status status = db->Get(roptions, ColumnFamily(table), rocksdb::Slice(key), &record);
+  if (status.IsNotFound()) {
+    return Insert(table, key, values);
+  }
+  assert(status.ok());
+  RecordCodec::Apply(record, values);
+  status = db->Put(woptions, ColumnFamily(table), rocksdb::Slice(key), rocksdb::Slice(record));
+  assert(status.ok());
+  return DB::kOK;
 }
 
 int RocksDB::Insert(const string &table, const string &key, vector<KVPair> &values)
 {
-  assert(values.size() == 1);
-  rocksdb::Status status = db->Put(woptions, rocksdb::Slice(key), rocksdb::Slice(values[0].second));
+  static thread_local string record;
+  if (bulk_loading) {
+    ThreadState *state = GetThreadState();
+    vector<KVPair> &records = state->bulk_records[ColumnFamily(table)];
+    records.emplace_back(key, string());
+    RecordCodec::Encode(values, records.back().second);
+    state->bulk_bytes += key.size() + records.back().second.size();
+    if (state->bulk_bytes >= bulk_buffer_bytes) {
+      WriteBulkFile(state);
+    }
+    return DB::kOK;
+  }
+  RecordCodec::Encode(values, record);
+  rocksdb::Status status = db->Put(woptions, ColumnFamily(table), rocksdb::Slice(key),
+                                   rocksdb::Slice(record));
   assert(status.ok());
   return DB::kOK;
 }
 
 int RocksDB::Delete(const string &table, const string &key)
 {
-  rocksdb::Status status = db->Delete(woptions, rocksdb::Slice(key));
+  rocksdb::Status status = db->Delete(woptions, ColumnFamily(table), rocksdb::Slice(key));
   assert(status.ok());
   return DB::kOK;
 }
 
+void RocksDB::MultiGet(ThreadState *state, rocksdb::ColumnFamilyHandle *cf,
+                       const vector<string> &keys)
+{
+  size_t n = keys.size();
+  state->keys.clear();
+  for (const string &key : keys) {
+    state->keys.emplace_back(key);
+  }
+  if (state->values.size() < n) {
+    state->values.resize(n);
+    state->statuses.resize(n);
+  }
+  // Misses in the block cache are read in parallel
+  db->MultiGet(roptions, cf, n, state->keys.data(),
+               state->values.data(), state->statuses.data());
+}
+
+void RocksDB::BatchRead(const string &table,
+                        const vector<string> &keys,
+                        const vector<const vector<string> *> &fields,
+                        vector<vector<KVPair>> &results,
+                        vector<int> &statuses)
+{
+  ThreadState *state = GetThreadState();
+  size_t n = keys.size();
+  Clock::time_point start = Clock::now();
+  MultiGet(state, ColumnFamily(table), keys);
+  results.resize(n);
+  statuses.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    rocksdb::PinnableSlice &value = state->values[i];
+    if (state->statuses[i].IsNotFound()) {
+      statuses[i] = DB::kErrorNoData;
+    } else {
+      assert(state->statuses[i].ok());
+      RecordCodec::Decode(value.data(), value.size(), fields[i], results[i]);
+      statuses[i] = DB::kOK;
+    }
+    value.Reset();
+  }
+  uint64_t ns = ElapsedNs(start);
+  state->read_batch_ns.Record(ns);
+  state->read_key_ns.Record(ns / n);
+}
+
+void RocksDB::BatchUpdate(const string &table,
+                          const vector<string> &keys,
+                          vector<vector<KVPair>> &values,
+                          vector<int> &statuses)
+{
+  ThreadState *state = GetThreadState();
+  size_t n = keys.size();
+  rocksdb::ColumnFamilyHandle *cf = ColumnFamily(table);
+  Clock::time_point start = Clock::now();
+  string &record = state->record;
+  if (merge_updates) {
+    for (size_t i = 0; i < n; ++i) {
+      RecordCodec::Encode(values[i], record);
+      state->batch.Merge(cf, rocksdb::Slice(keys[i]), rocksdb::Slice(record));
+    }
+  } else {
+    MultiGet(state, ColumnFamily(table), keys);
+    for (size_t i = 0; i < n; ++i) {
+      rocksdb::PinnableSlice &value = state->values[i];
+      if (state->statuses[i].IsNotFound()) {
+        RecordCodec::Encode(values[i], record);
+      } else {
+        assert(state->statuses[i].ok());
+        record.assign(value.data(), value.size());
+        RecordCodec::Apply(record, values[i]);
+      }
+      value.Reset();
+      state->batch.Put(cf, rocksdb::Slice(keys[i]), rocksdb::Slice(record));
+    }
+  }
+  rocksdb::Status status = db->Write(woptions, &state->batch);
+  assert(status.ok());
+  state->batch.Clear();
+  statuses.assign(n, int(DB::kOK));
+  uint64_t ns = ElapsedNs(start);
+  state->update_batch_ns.Record(ns);
+  state->update_key_ns.Record(ns / n);
+}
+
+void RocksDB::BatchInsert(const string &table,
+                          const vector<string> &keys,
+                          vector<vector<KVPair>> &values,
+                          vector<int> &statuses)
+{
+  if (bulk_loading) {
+    DB::BatchInsert(table, keys, values, statuses);
+    return;
+  }
+  ThreadState *state = GetThreadState();
+  size_t n = keys.size();
+  rocksdb::ColumnFamilyHandle *cf = ColumnFamily(table);
+  Clock::time_point start = Clock::now();
+  string &record = state->record;
+  for (size_t i = 0; i < n; ++i) {
+    RecordCodec::Encode(values[i], record);
+    state->batch.Put(cf, rocksdb::Slice(keys[i]), rocksdb::Slice(record));
+  }
+  rocksdb::Status status = db->Write(woptions, &state->batch);
+  assert(status.ok());
+  state->batch.Clear();
+  statuses.assign(n, int(DB::kOK));
+  uint64_t ns = ElapsedNs(start);
+  state->insert_batch_ns.Record(ns);
+  state->insert_key_ns.Record(ns / n);
+}
+
+void RocksDB::WriteBulkFile(ThreadState *state)
+{
+  for (auto &cf_records : state->bulk_records) {
+    rocksdb::ColumnFamilyHandle *cf = cf_records.first;
+    vector<KVPair> &records = cf_records.second;
+    if (records.empty()) {
+      continue;
+    }
+    // SstFileWriter takes keys in strictly increasing order: of duplicate
+    // keys, the last inserted one is kept
+    std::stable_sort(records.begin(), records.end(),
+                     [](const KVPair &a, const KVPair &b) { return a.first < b.first; });
+
+    string path;
+    {
+      std::lock_guard<std::mutex> lock(bulk_mutex);
+      path = bulk_dir + "/" + std::to_string(bulk_file_count++) + ".sst";
+      bulk_files[cf].push_back(path);
+    }
+    size_t cf_index = std::find(cf_handles.begin(), cf_handles.end(), cf) - cf_handles.begin();
+    rocksdb::SstFileWriter writer(rocksdb::EnvOptions(),
+                                  rocksdb::Options(options, cf_descriptors[cf_index].options), cf);
+    rocksdb::Status status = writer.Open(path);
+    assert(status.ok());
+    for (size_t i = 0; i < records.size(); ++i) {
+      if (i + 1 < records.size() && records[i].first == records[i + 1].first) {
+        continue;
+      }
+      status = writer.Put(rocksdb::Slice(records[i].first), rocksdb::Slice(records[i].second));
+      assert(status.ok());
+    }
+    status = writer.Finish();
+    assert(status.ok());
+    records.clear();
+  }
+  state->bulk_bytes = 0;
+}
+
+void RocksDB::IngestBulkFiles()
+{
+  bulk_loading = false;
+  if (bulk_files.empty()) {
+    return;
+  }
+  // Files of different threads overlap, and go to level 0 in the order
+  // they were written; compacting them leaves the database as if it had
+  // been loaded in key order
+  Clock::time_point start = Clock::now();
+  vector<rocksdb::IngestExternalFileArg> args;
+  for (auto &cf_files : bulk_files) {
+    args.emplace_back();
+    args.back().column_family = cf_files.first;
+    args.back().external_files = cf_files.second;
+    args.back().options.move_files = true;
+  }
+  rocksdb::Status status = db->IngestExternalFiles(args);
+  assert(status.ok());
+  bulk_ingest_seconds = ElapsedNs(start) / 1e9;
+
+  start = Clock::now();
+  rocksdb::CompactRangeOptions compact_options;
+  compact_options.max_subcompactions = options.max_subcompactions;
+  for (auto &cf_files : bulk_files) {
+    status = db->CompactRange(compact_options, cf_files.first, NULL, NULL);
+    assert(status.ok());
+  }
+  bulk_compact_seconds = ElapsedNs(start) / 1e9;
+  std::filesystem::remove_all(bulk_dir);
+}
+
+int RocksDB::ExecuteTransaction(const string &table, const vector<string> &keys,
+                                const vector<string> *fields,
+                                vector<vector<KVPair>> &results,
+                                vector<vector<KVPair>> &values)
+{
+  if (transaction_mode == "none") {
+    return DB::ExecuteTransaction(table, keys, fields, results, values);
+  }
+  ThreadState *state = GetThreadState();
+  TransactionCounts &counts = state->txn_counts;
+  for (int attempt = 0; ; ++attempt) {
+    int status = TryTransaction(state, ColumnFamily(table), keys, fields, results, values);
+    if (status != DB::kErrorConflict) {
+      counts.commits += (status == DB::kOK);
+      return status;
+    }
+    counts.aborts++;
+    if (attempt == transaction_retries) {
+      counts.failures++;
+      return status;
+    }
+    counts.retries++;
+  }
+}
+
+int RocksDB::TryTransaction(ThreadState *state, rocksdb::ColumnFamilyHandle *cf,
+                            const vector<string> &keys, const vector<string> *fields,
+                            vector<vector<KVPair>> &results, vector<vector<KVPair>> &values)
+{
+  // Reads are consistent as of the start of the transaction, and updated
+  // records must not change before it commits
+  rocksdb::Transaction *txn;
+  if (optimistic_db) {
+    rocksdb::OptimisticTransactionOptions options;
+    options.set_snapshot = true;
+    txn = optimistic_db->BeginTransaction(woptions, options, state->txn.get());
+  } else {
+    rocksdb::TransactionOptions options = txn_options;
+    options.set_snapshot = true;
+    txn = pessimistic_db->BeginTransaction(woptions, options, state->txn.get());
+  }
+  if (txn != state->txn.get()) {
+    state->txn.reset(txn);
+  }
+  rocksdb::ReadOptions read_options = roptions;
+  read_options.snapshot = txn->GetSnapshot();
+
+  // Locks are taken in key order, so pessimistic transactions cannot
+  // deadlock each other
+  vector<size_t> order(keys.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) {
+    return keys[a] < keys[b];
+  });
+
+  results.clear();
+  results.resize(keys.size());
+  int status = DB::kOK;
+  string &record = state->record;
+  for (size_t i : order) {
+    bool update = i < values.size();
+    rocksdb::Status s = update ?
+        txn->GetForUpdate(read_options, cf, rocksdb::Slice(keys[i]), &record) :
+        txn->Get(read_options, cf, rocksdb::Slice(keys[i]), &record);
+    if (s.IsNotFound()) {
+      status = DB::kErrorNoData;
+      continue;
+    }
+    if (s.IsBusy() || s.IsTimedOut() || s.IsTryAgain()) {
+      txn->Rollback();
+      return DB::kErrorConflict;
+    }
+    assert(s.ok());
+    RecordCodec::Decode(record.data(), record.size(), fields, results[i]);
+    if (update) {
+      RecordCodec::Apply(record, values[i]);
+      s = txn->Put(cf, rocksdb::Slice(keys[i]), rocksdb::Slice(record));
+      assert(s.ok());
+    }
+  }
+  rocksdb::Status s = txn->Commit();
+  if (s.IsBusy() || s.IsTimedOut() || s.IsTryAgain()) {
+    return DB::kErrorConflict;
+  }
+  assert(s.ok());
+  return status;
+}
+
+void RocksDB::SampleGet(ThreadState *state, uint64_t total_ns)
+{
+  rocksdb::SetPerfLevel(rocksdb::kDisable);
+  const rocksdb::PerfContext *perf = rocksdb::get_perf_context();
+  GetBreakdown &breakdown = state->get_breakdown;
+  breakdown.total_ns.Record(total_ns);
+  breakdown.memtable_ns.Record(perf->get_from_memtable_time);
+  breakdown.sst_files_ns.Record(perf->get_from_output_files_time);
+  breakdown.block_read_ns.Record(perf->block_read_time);
+  breakdown.block_decode_ns.Record(perf->block_checksum_time + perf->block_decompress_time);
+  breakdown.block_cache_hits += perf->block_cache_hit_count;
+  breakdown.block_reads += perf->block_read_count;
+  breakdown.bloom_memtable_checks += perf->bloom_memtable_hit_count +
+                                     perf->bloom_memtable_miss_count;
+  breakdown.bloom_sst_checks += perf->bloom_sst_hit_count + perf->bloom_sst_miss_count;
+  breakdown.bloom_sst_useful += perf->bloom_sst_miss_count;
+  breakdown.filter_block_reads += perf->filter_block_read_count;
+}
+
+void RocksDB::GetBreakdown::Merge(const GetBreakdown &other)
+{
+  total_ns.Merge(other.total_ns);
+  memtable_ns.Merge(other.memtable_ns);
+  sst_files_ns.Merge(other.sst_files_ns);
+  block_read_ns.Merge(other.block_read_ns);
+  block_decode_ns.Merge(other.block_decode_ns);
+  block_cache_hits += other.block_cache_hits;
+  block_reads += other.block_reads;
+  bloom_memtable_checks += other.bloom_memtable_checks;
+  bloom_sst_checks += other.bloom_sst_checks;
+  bloom_sst_useful += other.bloom_sst_useful;
+  filter_block_reads += other.filter_block_reads;
+}
+
+void RocksDB::GetBreakdown::Reset()
+{
+  total_ns.Reset();
+  memtable_ns.Reset();
+  sst_files_ns.Reset();
+  block_read_ns.Reset();
+  block_decode_ns.Reset();
+  block_cache_hits = 0;
+  block_reads = 0;
+  bloom_memtable_checks = 0;
+  bloom_sst_checks = 0;
+  bloom_sst_useful = 0;
+  filter_block_reads = 0;
+}
+
+void RocksDB::PrintStats(std::ostream &out)
+{
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    uint64_t attempts = txn_counts.commits + txn_counts.aborts;
+    if (attempts > 0) {
+      out << "# RocksDB " << transaction_mode
+          << " transactions: commits aborts retries failures abort_rate" << endl;
+      out << txn_counts.commits << '\t' << txn_counts.aborts << '\t' << txn_counts.retries << '\t'
+          << txn_counts.failures << '\t' << (double)txn_counts.aborts / attempts << endl;
+    }
+    txn_counts = TransactionCounts();
+  }
+
+  if (options.statistics) {
+    // Statistics are reset after each phase, so that they cover one phase
+    rocksdb::Statistics *stats = options.statistics.get();
+    const std::pair<const char *, rocksdb::Tickers> tickers[] = {
+      {"block_cache_hit", rocksdb::BLOCK_CACHE_HIT},
+      {"block_cache_miss", rocksdb::BLOCK_CACHE_MISS},
+      {"bloom_useful", rocksdb::BLOOM_FILTER_USEFUL},
+      {"bytes_read", rocksdb::BYTES_READ},
+      {"bytes_written", rocksdb::BYTES_WRITTEN},
+      {"wal_bytes", rocksdb::WAL_FILE_BYTES},
+      {"flush_write_bytes", rocksdb::FLUSH_WRITE_BYTES},
+      {"compact_read_bytes", rocksdb::COMPACT_READ_BYTES},
+      {"compact_write_bytes", rocksdb::COMPACT_WRITE_BYTES},
+      {"stall_micros", rocksdb::STALL_MICROS},
+    };
+    out << "# RocksDB statistics:";
+    for (auto &ticker : tickers) {
+      out << ' ' << ticker.first;
+    }
+    out << " write_amplification" << endl;
+    for (auto &ticker : tickers) {
+      out << stats->getTickerCount(ticker.second) << '\t';
+    }
+    // Bytes written to SST files per byte written by the clients
+    uint64_t bytes_written = stats->getTickerCount(rocksdb::BYTES_WRITTEN);
+    uint64_t sst_bytes = stats->getTickerCount(rocksdb::FLUSH_WRITE_BYTES) +
+                         stats->getTickerCount(rocksdb::COMPACT_WRITE_BYTES);
+    out << (bytes_written ? (double)sst_bytes / bytes_written : 0) << endl;
+
+    const std::pair<const char *, rocksdb::Histograms> histograms[] = {
+      {"get", rocksdb::DB_GET},
+      {"multiget", rocksdb::DB_MULTIGET},
+      {"write", rocksdb::DB_WRITE},
+      {"seek", rocksdb::DB_SEEK},
+    };
+    out << "# RocksDB latency (us): count avg p50 p99 max" << endl;
+    for (auto &histogram : histograms) {
+      rocksdb::HistogramData data;
+      stats->histogramData(histogram.second, &data);
+      if (data.count > 0) {
+        out << histogram.first << '\t' << data.count << '\t' << data.average << '\t'
+            << data.median << '\t' << data.percentile99 << '\t' << data.max << endl;
+      }
+    }
+    stats->Reset();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    GetBreakdown &breakdown = get_breakdown;
+    uint64_t count = breakdown.total_ns.Count();
+    if (count > 0) {
+      out << "# RocksDB sampled Get breakdown (us): count avg p50 p99 p99.9 max" << endl;
+      const std::pair<const char *, utils::Histogram *> rows[] = {
+        {"total", &breakdown.total_ns},
+        {"memtable", &breakdown.memtable_ns},
+        {"sst_files", &breakdown.sst_files_ns},
+        {"block_read", &breakdown.block_read_ns},
+        {"block_checksum_decompress", &breakdown.block_decode_ns},
+      };
+      for (auto &row : rows) {
+        out << row.first << '\t' << row.second->Count() << '\t';
+        row.second->PrintSummary(out, 1000);
+        out << endl;
+      }
+      out << "# RocksDB sampled Get counts per Get: block_cache_hits block_reads "
+             "bloom_memtable_checks bloom_sst_checks bloom_useful filter_block_reads" << endl;
+      out << (double)breakdown.block_cache_hits / count << '\t'
+          << (double)breakdown.block_reads / count << '\t'
+          << (double)breakdown.bloom_memtable_checks / count << '\t'
+          << (double)breakdown.bloom_sst_checks / count << '\t'
+          << (double)breakdown.bloom_sst_useful / count << '\t'
+          << (double)breakdown.filter_block_reads / count << endl;
+    }
+    breakdown.Reset();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(bulk_mutex);
+    if (bulk_file_count > 0) {
+      out << "# RocksDB bulk load: files ingest (s) compaction (s)" << endl;
+      out << bulk_file_count << '\t' << bulk_ingest_seconds << '\t'
+          << bulk_compact_seconds << endl;
+      bulk_files.clear();
+      bulk_file_count = 0;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  const std::pair<const char *, utils::Histogram *> rows[] = {
+    {"multiget", &read_batch_ns},
+    {"multiget_per_key", &read_key_ns},
+    {"update_batch", &update_batch_ns},
+    {"update_per_key", &update_key_ns},
+    {"insert_batch", &insert_batch_ns},
+    {"insert_per_key", &insert_key_ns},
+  };
+  bool header = false;
+  for (auto &row : rows) {
+    if (row.second->Count() > 0) {
+      if (!header) {
+        out << "# RocksDB batch latency (us): count avg p50 p99 p99.9 max" << endl;
+        header = true;
+      }
+      out << row.first << '\t' << row.second->Count() << '\t';
+      row.second->PrintSummary(out, 1000);
+      out << endl;
+    }
+    row.second->Reset();
+  }
+}
+
 } // ycsbc
 
 
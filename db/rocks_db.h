@@ -9,9 +9,18 @@
 #include "core/db.h"
 
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/histogram.h"
 #include "core/properties.h"
 #include "rocksdb/db.h"
+#include "rocksdb/statistics.h"
+#include "rocksdb/utilities/optimistic_transaction_db.h"
+#include "rocksdb/utilities/transaction_db.h"
 
 using std::cout;
 using std::endl;
@@ -42,14 +51,221 @@ public:
 
   int Delete(const std::string &table, const std::string &key);
 
+  void BatchRead(const std::string &table, const std::vector<std::string> &keys,
+                 const std::vector<const std::vector<std::string> *> &fields,
+                 std::vector<std::vector<KVPair>> &results,
+                 std::vector<int> &statuses);
+
+  void BatchUpdate(const std::string &table, const std::vector<std::string> &keys,
+                   std::vector<std::vector<KVPair>> &values,
+                   std::vector<int> &statuses);
+
+  void BatchInsert(const std::string &table, const std::vector<std::string> &keys,
+                   std::vector<std::vector<KVPair>> &values,
+                   std::vector<int> &statuses);
+
+  int ExecuteTransaction(const std::string &table, const std::vector<std::string> &keys,
+                         const std::vector<std::string> *fields,
+                         std::vector<std::vector<KVPair>> &results,
+                         std::vector<std::vector<KVPair>> &values);
+
+  void PrintStats(std::ostream &out);
+
 private:
+  ///
+  /// Outcomes of multi-key transactions.
+  ///
+  struct TransactionCounts {
+    uint64_t commits = 0;
+    uint64_t aborts = 0;   /// Conflicts, retried or not
+    uint64_t retries = 0;
+    uint64_t failures = 0; /// Aborted on the last attempt
+
+    void Merge(const TransactionCounts &other) {
+      commits += other.commits;
+      aborts += other.aborts;
+      retries += other.retries;
+      failures += other.failures;
+    }
+  };
+
+  ///
+  /// Where the time of sampled Gets goes, from the PerfContext.
+  ///
+  struct GetBreakdown {
+    utils::Histogram total_ns;
+    utils::Histogram memtable_ns;
+    utils::Histogram sst_files_ns;
+    utils::Histogram block_read_ns;   /// Block cache misses
+    utils::Histogram block_decode_ns; /// Checksum and decompression
+    uint64_t         block_cache_hits = 0;
+    uint64_t         block_reads = 0;
+    /// Bloom filter probes: RocksDB does not time them, so they are
+    /// counted, with the filter blocks read (their time is in block_read_ns)
+    uint64_t         bloom_memtable_checks = 0;
+    uint64_t         bloom_sst_checks = 0;
+    uint64_t         bloom_sst_useful = 0; /// SST files skipped by their filter
+    uint64_t         filter_block_reads = 0;
+
+    void Merge(const GetBreakdown &other);
+    void Reset();
+  };
+
+  ///
+  /// State of a client thread, set up by Init() and reused by every
+  /// operation of the thread.
+  ///
+  struct ThreadState {
+    std::vector<rocksdb::Slice>         keys;
+    std::vector<rocksdb::PinnableSlice> values;
+    std::vector<rocksdb::Status>        statuses;
+    rocksdb::WriteBatch                 batch;
+    std::string                         record;
+    /// Encoded records not yet in a file, by column family
+    std::unordered_map<rocksdb::ColumnFamilyHandle *, std::vector<KVPair>> bulk_records;
+    size_t                              bulk_bytes;
+    utils::Histogram                    read_batch_ns;
+    utils::Histogram                    read_key_ns;   /// Average per key of each batch
+    utils::Histogram                    update_batch_ns;
+    utils::Histogram                    update_key_ns;
+    utils::Histogram                    insert_batch_ns;
+    utils::Histogram                    insert_key_ns;
+    uint64_t                            gets;         /// Counted to sample one in perf_sample_rate
+    GetBreakdown                        get_breakdown;
+    /// Iterators reused by the scans of the thread, by column family
+    std::unordered_map<rocksdb::ColumnFamilyHandle *, std::unique_ptr<rocksdb::Iterator>> iterators;
+    std::unordered_map<rocksdb::ColumnFamilyHandle *, std::unique_ptr<rocksdb::Iterator>> bounded_iterators;
+    std::string                         scan_bound;
+    rocksdb::Slice                      scan_bound_slice; /// Upper bound of bounded_iterators
+    std::unique_ptr<rocksdb::Transaction> txn;        /// Reused by the transactions of the thread
+    TransactionCounts                   txn_counts;
+  };
 
   void InitializeOptions(utils::Properties &props);
 
+  ///
+  /// Opens the database with a column family for each table that has
+  /// rocksdb.cf.<table>.* options, and any column family it already has.
+  ///
+  void Open(const std::string &filename, bool preloaded);
+
+  ///
+  /// The column family of a table: its own, or the default one.
+  ///
+  rocksdb::ColumnFamilyHandle *ColumnFamily(const std::string &table) const {
+    auto it = column_families.find(table);
+    return it == column_families.end() ? default_cf : it->second;
+  }
+
+  ///
+  /// Writes the records buffered by a bulk loading thread to an SST file
+  /// per column family, in key order.
+  ///
+  void WriteBulkFile(ThreadState *state);
+
+  ///
+  /// Ingests the SST files of all bulk loading threads in one step, then
+  /// compacts them into a single sorted run.
+  ///
+  void IngestBulkFiles();
+
+  ///
+  /// Looks up keys with a single MultiGet, into the values and statuses
+  /// of the thread state.
+  ///
+  void MultiGet(ThreadState *state, rocksdb::ColumnFamilyHandle *cf,
+                const std::vector<std::string> &keys);
+
+  ///
+  /// Adds the PerfContext of a sampled Get to the breakdown of the thread.
+  ///
+  void SampleGet(ThreadState *state, uint64_t total_ns);
+
+  ///
+  /// The iterator of the thread over a column family, created by its first
+  /// scan and refreshed by the next ones to see the writes in between.
+  /// Bounded iterators stop at the scan_bound_slice of the thread state.
+  ///
+  rocksdb::Iterator *ScanIterator(ThreadState *state, rocksdb::ColumnFamilyHandle *cf,
+                                  bool bounded);
+
+  ///
+  /// Makes one attempt at a multi-key transaction. Returns kErrorConflict
+  /// if it was aborted, after rolling it back.
+  ///
+  int TryTransaction(ThreadState *state, rocksdb::ColumnFamilyHandle *cf,
+                     const std::vector<std::string> &keys,
+                     const std::vector<std::string> *fields,
+                     std::vector<std::vector<KVPair>> &results,
+                     std::vector<std::vector<KVPair>> &values);
+
+  ///
+  /// The state of the calling thread, looked up in thread_states_ only when
+  /// the thread last used another instance.
+  ///
+  ThreadState *GetThreadState() {
+    if (cached_owner_ != this) {
+      cached_state_ = thread_states_.at(this);
+      cached_owner_ = this;
+    }
+    return cached_state_;
+  }
+
+  static thread_local std::unordered_map<const RocksDB *, ThreadState *> thread_states_;
+  static thread_local const RocksDB *cached_owner_;
+  static thread_local ThreadState *cached_state_;
+
   rocksdb::DB *db;
   rocksdb::Options options;
+  std::shared_ptr<rocksdb::Statistics> statistics; /// Set by rocksdb.statistics
+  /// rocksdb.cf.<table>.* options, by table
+  std::map<std::string, std::unordered_map<std::string, std::string>> cf_options_maps;
+  std::vector<rocksdb::ColumnFamilyDescriptor> cf_descriptors;
+  std::vector<rocksdb::ColumnFamilyHandle *> cf_handles; /// Of cf_descriptors
+  std::unordered_map<std::string, rocksdb::ColumnFamilyHandle *> column_families; /// By table
+  rocksdb::ColumnFamilyHandle *default_cf;
   rocksdb::ReadOptions roptions;
+  rocksdb::ReadOptions scan_options; /// Of the iterators
   rocksdb::WriteOptions woptions;
+  bool bounded_scans; /// Stop scans past the last record number
+  size_t prefix_length; /// Of the prefix extractor, or 0 for none
+  bool merge_updates; /// Update through Merge, or read-modify-write
+  uint64_t perf_sample_rate; /// Gets per sampled one, or 0 for no sampling
+
+  ///
+  /// With rocksdb.transactions set, the database is opened as an
+  /// OptimisticTransactionDB or a TransactionDB, which db points to as
+  /// well. Otherwise multi-key transactions are not atomic.
+  ///
+  std::string transaction_mode; /// "none", "optimistic" or "pessimistic"
+  rocksdb::OptimisticTransactionDB *optimistic_db;
+  rocksdb::TransactionDB *pessimistic_db;
+  rocksdb::TransactionOptions txn_options;
+  int transaction_retries; /// Attempts after the first, on conflicts
+
+  ///
+  /// Bulk loading writes inserts to SST files, ingested once the last
+  /// thread of the Load phase closes. Later inserts are written normally.
+  ///
+  bool bulk_loading;
+  uint64_t bulk_buffer_bytes; /// Buffered by a thread before writing a file
+  std::string bulk_dir;
+  std::mutex bulk_mutex; /// Guards the fields below
+  unsigned int loading_threads; /// Still to close in the Load phase
+  std::map<rocksdb::ColumnFamilyHandle *, std::vector<std::string>> bulk_files;
+  size_t bulk_file_count;
+  double bulk_ingest_seconds;
+  double bulk_compact_seconds;
+
+  std::mutex stats_mutex; /// Guards the histograms below
+  utils::Histogram read_batch_ns;
+  utils::Histogram read_key_ns;
+  utils::Histogram update_batch_ns;
+  utils::Histogram update_key_ns;
+  utils::Histogram insert_batch_ns;
+  utils::Histogram insert_key_ns;
+  GetBreakdown get_breakdown;
+  TransactionCounts txn_counts;
 };
 
 } // ycsbc
@@ -0,0 +1,45 @@
+//
+//  scan_bound.h
+//  YCSB-C
+//
+//  Upper bound of a range scan, for keys that end in a fixed-width decimal
+//  record number, as generated with insertorder=ordered.
+//
+
+#ifndef YCSB_C_SCAN_BOUND_H_
+#define YCSB_C_SCAN_BOUND_H_
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+
+namespace ycsbc {
+
+///
+/// Computes the first key past a scan of len records starting at key, i.e.
+/// the key whose number is len greater. Returns false if the key does not
+/// end in a number or the bound does not fit in the same number of digits.
+///
+inline bool ScanUpperBound(const std::string &key, int len, std::string &bound) {
+  size_t digits = 0;
+  while (digits < key.size() && digits < 19 &&
+         isdigit((unsigned char)key[key.size() - 1 - digits])) {
+    digits++;
+  }
+  if (digits == 0 || len <= 0) {
+    return false;
+  }
+  size_t start = key.size() - digits;
+  uint64_t num = std::stoull(key.substr(start)) + len;
+  std::string suffix = std::to_string(num);
+  if (suffix.size() > digits) {
+    return false;
+  }
+  bound.assign(key, 0, start);
+  bound.append(digits - suffix.size(), '0').append(suffix);
+  return true;
+}
+
+} // ycsbc
+
+#endif // YCSB_C_SCAN_BOUND_H_
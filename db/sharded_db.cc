@@ -0,0 +1,373 @@
+//
+//  sharded_db.cc
+//  YCSB-C
+//
+
+#include "db/sharded_db.h"
+#include "db/db_factory.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include "core/utils.h"
+
+using std::string;
+using std::vector;
+
+namespace ycsbc {
+
+///
+/// Divides a size, in bytes with an optional K, M, G or T suffix as RocksDB
+/// parses them, or in the unit of the property, by n. Zero, which leaves
+/// the size to the backend, stays zero.
+///
+static string DivideSize(const string &size, size_t n) {
+  size_t end;
+  uint64_t value = std::stoull(size, &end);
+  if (end < size.size()) {
+    const char *suffixes = "KMGT";
+    const char *suffix = strchr(suffixes, toupper(size[end]));
+    if (!suffix || !*suffix) {
+      throw utils::Exception("Cannot divide size over shards: " + size);
+    }
+    value <<= 10 * (suffix - suffixes + 1);
+  }
+  return std::to_string(value == 0 ? 0 : std::max<uint64_t>(value / n, 1));
+}
+
+///
+/// Divides the block_cache size in the options of a block-based table
+/// factory by n.
+///
+static string DivideBlockCache(const string &table_options, size_t n) {
+  const string name = "block_cache=";
+  size_t start = table_options.find(name);
+  if (start == string::npos || !isdigit((unsigned char)table_options[start + name.size()])) {
+    return table_options;
+  }
+  start += name.size();
+  size_t end = std::min(table_options.find_first_of(";}", start), table_options.size());
+  return table_options.substr(0, start) +
+         DivideSize(table_options.substr(start, end - start), n) + table_options.substr(end);
+}
+
+ShardedDB::ShardedDB(utils::Properties &props, bool preloaded) {
+  string backend = props.GetProperty("sharded.backend");
+  size_t num_shards = props.GetIntProperty("sharded.shards");
+  if (backend.empty() || backend == "sharded" || num_shards == 0) {
+    throw utils::Exception("sharded needs a sharded.backend and sharded.shards");
+  }
+  workers_per_shard_ = props.GetIntProperty("sharded.workers");
+  if (backend == "splinterdb" && num_shards > 1 && workers_per_shard_ == 0) {
+    // SplinterDB keeps the id of a registered thread in a single
+    // thread-local, so a thread cannot register with several instances
+    workers_per_shard_ = props.GetIntProperty("threadcount");
+  }
+  num_clients_ = 0;
+
+  string routing = props.GetProperty("sharded.routing", "hash");
+  if (routing != "hash" && routing != "range") {
+    throw utils::Exception("Unknown sharded.routing: " + routing);
+  }
+  range_routing_ = routing == "range";
+  if (range_routing_) {
+    std::stringstream boundaries(props.GetProperty("sharded.boundaries"));
+    string boundary;
+    while (std::getline(boundaries, boundary, ',')) {
+      boundaries_.push_back(utils::Trim(boundary));
+    }
+    // The split keys depend on keyprefix, zeropadding, insertorder and
+    // recordcount of the workloads, which databases do not see
+    if (boundaries_.size() != num_shards - 1 ||
+        !std::is_sorted(boundaries_.begin(), boundaries_.end())) {
+      throw utils::Exception("sharded.boundaries needs sharded.shards - 1 sorted keys");
+    }
+  }
+
+  for (size_t i = 0; i < num_shards; ++i) {
+    string prefix = "sharded." + std::to_string(i) + ".";
+    utils::Properties *shard = new utils::Properties(props.Overlay(prefix));
+    shard->SetProperty("dbname", backend);
+    // Unless overridden, each shard gets its own files
+    for (const char *name : {"splinterdb.filename", "rocksdb.database_filename"}) {
+      if (props.GetProperty(prefix + name).empty() && !props.GetProperty(name).empty()) {
+        shard->SetProperty(name, props.GetProperty(name) + "." + std::to_string(i));
+      }
+    }
+    // Unless overridden, the shards split the cache and memtable budget
+    for (const char *name : {"splinterdb.cache_size_mb", "splinterdb.memtable_capacity",
+                             "rocksdb.options.write_buffer_size",
+                             "rocksdb.options.db_write_buffer_size"}) {
+      if (props.GetProperty(prefix + name).empty() && !props.GetProperty(name).empty()) {
+        shard->SetProperty(name, DivideSize(props.GetProperty(name), num_shards));
+      }
+    }
+    const string table_factory = "rocksdb.options.block_based_table_factory";
+    if (props.GetProperty(prefix + table_factory).empty() &&
+        !props.GetProperty(table_factory).empty()) {
+      shard->SetProperty(table_factory,
+                         DivideBlockCache(props.GetProperty(table_factory), num_shards));
+    }
+    shard_props_.emplace_back(shard);
+    DB *db = DBFactory::CreateDB(*shard, preloaded);
+    if (!db) {
+      throw utils::Exception("Unknown sharded.backend: " + backend);
+    }
+    shards_.push_back(db);
+    if (workers_per_shard_ > 0) {
+      queues_.emplace_back(new WorkQueue);
+    }
+  }
+}
+
+ShardedDB::~ShardedDB() {
+  for (DB *db : shards_) {
+    delete db;
+  }
+}
+
+void ShardedDB::Init() {
+  if (queues_.empty()) {
+    for (DB *db : shards_) {
+      db->Init();
+    }
+    return;
+  }
+  // Workers run while any client does, and close the shards when the last
+  // client leaves so that their statistics are merged before PrintStats
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  if (num_clients_++ == 0) {
+    StartWorkers();
+  }
+}
+
+void ShardedDB::Close() {
+  if (queues_.empty()) {
+    for (DB *db : shards_) {
+      db->Close();
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> lock(clients_mutex_);
+  if (--num_clients_ == 0) {
+    StopWorkers();
+  }
+}
+
+void ShardedDB::StartWorkers() {
+  for (size_t shard = 0; shard < queues_.size(); ++shard) {
+    queues_[shard]->stopping = false;
+    for (size_t i = 0; i < workers_per_shard_; ++i) {
+      queues_[shard]->threads.emplace_back(&ShardedDB::Work, this, shard);
+    }
+  }
+}
+
+void ShardedDB::StopWorkers() {
+  for (std::unique_ptr<WorkQueue> &queue : queues_) {
+    {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->stopping = true;
+    }
+    queue->ready.notify_all();
+    for (std::thread &thread : queue->threads) {
+      thread.join();
+    }
+    queue->threads.clear();
+  }
+}
+
+void ShardedDB::Work(size_t shard) {
+  WorkQueue &queue = *queues_[shard];
+  shards_[shard]->Init();
+  while (true) {
+    std::packaged_task<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      queue.ready.wait(lock, [&queue] { return queue.stopping || !queue.tasks.empty(); });
+      if (queue.tasks.empty()) {
+        break;
+      }
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    task();
+  }
+  shards_[shard]->Close();
+}
+
+void ShardedDB::RunOnWorker(size_t shard, const std::function<void(DB *)> &op) {
+  WorkQueue &queue = *queues_[shard];
+  DB *db = shards_[shard];
+  std::packaged_task<void()> task([&op, db] { op(db); });
+  std::future<void> done = task.get_future();
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  queue.ready.notify_one();
+  done.get();
+}
+
+size_t ShardedDB::ShardOf(const string &key) const {
+  if (range_routing_) {
+    return std::upper_bound(boundaries_.begin(), boundaries_.end(), key) - boundaries_.begin();
+  }
+  return std::hash<string>()(key) % shards_.size();
+}
+
+int ShardedDB::Read(const string &table, const string &key,
+                    const vector<string> *fields, vector<KVPair> &result) {
+  int status;
+  OnShard(ShardOf(key), [&](DB *db) { status = db->Read(table, key, fields, result); });
+  return status;
+}
+
+int ShardedDB::Scan(const string &table, const string &key, int len,
+                    const vector<string> *fields, vector<vector<KVPair>> &result) {
+  if (range_routing_) {
+    // Shards hold consecutive ranges: go on in the next shards until
+    // enough records are found
+    size_t shard = ShardOf(key);
+    const string *start = &key;
+    while ((int)result.size() < len && shard < shards_.size()) {
+      vector<vector<KVPair>> records;
+      int status;
+      OnShard(shard, [&](DB *db) {
+        status = db->Scan(table, *start, len - result.size(), fields, records);
+      });
+      if (status != DB::kOK) {
+        return status;
+      }
+      std::move(records.begin(), records.end(), std::back_inserter(result));
+      start = &boundaries_[std::min(shard, boundaries_.size() - 1)];
+      shard++;
+    }
+    return DB::kOK;
+  }
+
+  // Hashed keys of a range are spread over all shards, so each shard is
+  // scanned for as many records as an ordered merge could take from it.
+  // Records carry no keys, so the first len found are kept.
+  for (size_t shard = 0; shard < shards_.size(); ++shard) {
+    vector<vector<KVPair>> records;
+    int status;
+    OnShard(shard, [&](DB *db) { status = db->Scan(table, key, len, fields, records); });
+    if (status != DB::kOK) {
+      return status;
+    }
+    size_t n = std::min(records.size(), len - result.size());
+    std::move(records.begin(), records.begin() + n, std::back_inserter(result));
+  }
+  return DB::kOK;
+}
+
+int ShardedDB::Update(const string &table, const string &key, vector<KVPair> &values) {
+  int status;
+  OnShard(ShardOf(key), [&](DB *db) { status = db->Update(table, key, values); });
+  return status;
+}
+
+int ShardedDB::Insert(const string &table, const string &key, vector<KVPair> &values) {
+  int status;
+  OnShard(ShardOf(key), [&](DB *db) { status = db->Insert(table, key, values); });
+  return status;
+}
+
+int ShardedDB::Delete(const string &table, const string &key) {
+  int status;
+  OnShard(ShardOf(key), [&](DB *db) { status = db->Delete(table, key); });
+  return status;
+}
+
+vector<vector<size_t>> ShardedDB::SplitBatch(const vector<string> &keys) const {
+  vector<vector<size_t>> split(shards_.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    split[ShardOf(keys[i])].push_back(i);
+  }
+  return split;
+}
+
+void ShardedDB::BatchRead(const string &table, const vector<string> &keys,
+                          const vector<const vector<string> *> &fields,
+                          vector<vector<KVPair>> &results, vector<int> &statuses) {
+  results.resize(keys.size());
+  statuses.resize(keys.size());
+  vector<vector<size_t>> split = SplitBatch(keys);
+  for (size_t shard = 0; shard < shards_.size(); ++shard) {
+    const vector<size_t> &indexes = split[shard];
+    if (indexes.empty()) {
+      continue;
+    }
+    vector<string> shard_keys;
+    vector<const vector<string> *> shard_fields;
+    for (size_t i : indexes) {
+      shard_keys.push_back(keys[i]);
+      shard_fields.push_back(fields[i]);
+    }
+    vector<vector<KVPair>> shard_results;
+    vector<int> shard_statuses;
+    OnShard(shard, [&](DB *db) {
+      db->BatchRead(table, shard_keys, shard_fields, shard_results, shard_statuses);
+    });
+    for (size_t j = 0; j < indexes.size(); ++j) {
+      results[indexes[j]] = std::move(shard_results[j]);
+      statuses[indexes[j]] = shard_statuses[j];
+    }
+  }
+}
+
+void ShardedDB::BatchWrite(bool update, const string &table, const vector<string> &keys,
+                           vector<vector<KVPair>> &values, vector<int> &statuses) {
+  statuses.resize(keys.size());
+  vector<vector<size_t>> split = SplitBatch(keys);
+  for (size_t shard = 0; shard < shards_.size(); ++shard) {
+    const vector<size_t> &indexes = split[shard];
+    if (indexes.empty()) {
+      continue;
+    }
+    vector<string> shard_keys;
+    vector<vector<KVPair>> shard_values;
+    for (size_t i : indexes) {
+      shard_keys.push_back(keys[i]);
+      shard_values.push_back(std::move(values[i]));
+    }
+    vector<int> shard_statuses;
+    OnShard(shard, [&](DB *db) {
+      if (update) {
+        db->BatchUpdate(table, shard_keys, shard_values, shard_statuses);
+      } else {
+        db->BatchInsert(table, shard_keys, shard_values, shard_statuses);
+      }
+    });
+    for (size_t j = 0; j < indexes.size(); ++j) {
+      values[indexes[j]] = std::move(shard_values[j]);
+      statuses[indexes[j]] = shard_statuses[j];
+    }
+  }
+}
+
+void ShardedDB::BatchUpdate(const string &table, const vector<string> &keys,
+                            vector<vector<KVPair>> &values, vector<int> &statuses) {
+  BatchWrite(true, table, keys, values, statuses);
+}
+
+void ShardedDB::BatchInsert(const string &table, const vector<string> &keys,
+                            vector<vector<KVPair>> &values, vector<int> &statuses) {
+  BatchWrite(false, table, keys, values, statuses);
+}
+
+void ShardedDB::PrintStats(std::ostream &out) {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    std::ostringstream stats;
+    shards_[i]->PrintStats(stats);
+    if (!stats.str().empty()) {
+      out << "# Shard " << i << std::endl << stats.str();
+    }
+  }
+}
+
+} // ycsbc
@@ -0,0 +1,134 @@
+//
+//  sharded_db.h
+//  YCSB-C
+//
+//  N independent instances of a backend, with keys routed to them by hash
+//  or by range. With sharded.workers > 0, each shard is served by that many
+//  worker threads of its own, to which the client threads hand their
+//  operations, so that only the workers register with the shard. This is
+//  the default for SplinterDB, whose threads register with one instance.
+//
+//  sharded.backend=splinterdb   (any dbname known to DBFactory)
+//  sharded.shards=4
+//  sharded.workers=0            (per shard; default threadcount for splinterdb)
+//  sharded.routing=hash         (or "range")
+//  sharded.boundaries=user3,user6,user9   (required for range routing, N-1 split keys)
+//  sharded.<i>.<property>=...   (overrides a property for shard i)
+//
+
+#ifndef YCSB_C_SHARDED_DB_H_
+#define YCSB_C_SHARDED_DB_H_
+
+#include "core/db.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/properties.h"
+
+namespace ycsbc {
+
+class ShardedDB : public DB {
+ public:
+  ShardedDB(utils::Properties &props, bool preloaded);
+  ~ShardedDB();
+
+  void Init();
+  void Close();
+
+  int Read(const std::string &table, const std::string &key,
+           const std::vector<std::string> *fields,
+           std::vector<KVPair> &result);
+
+  int Scan(const std::string &table, const std::string &key,
+           int len, const std::vector<std::string> *fields,
+           std::vector<std::vector<KVPair>> &result);
+
+  int Update(const std::string &table, const std::string &key,
+             std::vector<KVPair> &values);
+
+  int Insert(const std::string &table, const std::string &key,
+             std::vector<KVPair> &values);
+
+  int Delete(const std::string &table, const std::string &key);
+
+  void BatchRead(const std::string &table, const std::vector<std::string> &keys,
+                 const std::vector<const std::vector<std::string> *> &fields,
+                 std::vector<std::vector<KVPair>> &results,
+                 std::vector<int> &statuses);
+
+  void BatchUpdate(const std::string &table, const std::vector<std::string> &keys,
+                   std::vector<std::vector<KVPair>> &values,
+                   std::vector<int> &statuses);
+
+  void BatchInsert(const std::string &table, const std::vector<std::string> &keys,
+                   std::vector<std::vector<KVPair>> &values,
+                   std::vector<int> &statuses);
+
+  void PrintStats(std::ostream &out);
+
+ private:
+  struct WorkQueue {
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::packaged_task<void()>> tasks;
+    bool stopping;
+    std::vector<std::thread> threads;
+  };
+
+  size_t ShardOf(const std::string &key) const;
+
+  ///
+  /// Applies op to the shard, on one of its workers if it has any.
+  ///
+  template<class Op>
+  void OnShard(size_t shard, Op op) {
+    if (queues_.empty()) {
+      op(shards_[shard]);
+    } else {
+      RunOnWorker(shard, op);
+    }
+  }
+
+  void RunOnWorker(size_t shard, const std::function<void(DB *)> &op);
+
+  ///
+  /// Body of a worker thread: runs the tasks queued for the shard between
+  /// Init and Close of the shard.
+  ///
+  void Work(size_t shard);
+  void StartWorkers();
+  void StopWorkers();
+
+  ///
+  /// The indexes of the keys that go to each shard.
+  ///
+  std::vector<std::vector<size_t>> SplitBatch(const std::vector<std::string> &keys) const;
+
+  ///
+  /// Issues a batch of writes as one batch per shard.
+  ///
+  void BatchWrite(bool update, const std::string &table, const std::vector<std::string> &keys,
+                  std::vector<std::vector<KVPair>> &values, std::vector<int> &statuses);
+
+  /// Backends may keep pointers into their properties, which thus live
+  /// as long as the shards.
+  std::vector<std::unique_ptr<utils::Properties>> shard_props_;
+  std::vector<DB *> shards_;
+  bool range_routing_;
+  std::vector<std::string> boundaries_; /// First key of each shard but the first
+  size_t workers_per_shard_;
+  std::vector<std::unique_ptr<WorkQueue>> queues_; /// Empty without workers
+  std::mutex clients_mutex_;
+  size_t num_clients_; /// Client threads between Init and Close
+};
+
+} // ycsbc
+
+#endif // YCSB_C_SHARDED_DB_H_
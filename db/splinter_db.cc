@@ -7,10 +7,15 @@
 //
 
 #include "db/splinter_db.h"
+#include "db/record_codec.h"
+#include "db/scan_bound.h"
 extern "C" {
 #include "splinterdb/default_data_config.h"
+#include "splinterdb/public_platform.h"
 }
 
+#include <chrono>
+#include <cstdio>
 #include <string>
 #include <vector>
 
@@ -19,10 +24,59 @@ using std::vector;
 
 namespace ycsbc {
 
+thread_local std::unordered_map<const SplinterDB *, SplinterDB::ThreadState *>
+    SplinterDB::thread_states_;
+thread_local const SplinterDB *SplinterDB::cached_owner_ = NULL;
+thread_local SplinterDB::ThreadState *SplinterDB::cached_state_ = NULL;
+
+///
+/// Folds an older message into a newer update message. Records and
+/// updates are both encoded with RecordCodec, so the fields of the update
+/// replace those of the older record or update.
+///
+static int MergeTuples(const data_config *cfg, slice key,
+                       message old_message, merge_accumulator *new_message) {
+  if (merge_accumulator_message_class(new_message) != MESSAGE_TYPE_UPDATE) {
+    return 0; // Inserts and deletes hide anything older
+  }
+  message_type old_class = message_class(old_message);
+  if (old_class == MESSAGE_TYPE_DELETE) {
+    merge_accumulator_set_class(new_message, MESSAGE_TYPE_INSERT);
+    return 0;
+  }
+
+  static thread_local string merged;
+  slice old_slice = message_slice(old_message);
+  RecordCodec::Merge((const char *)slice_data(old_slice), slice_length(old_slice),
+                     (const char *)merge_accumulator_data(new_message),
+                     merge_accumulator_length(new_message), merged);
+  if (!merge_accumulator_resize(new_message, merged.size())) {
+    return -1;
+  }
+  memcpy(merge_accumulator_data(new_message), merged.data(), merged.size());
+  merge_accumulator_set_class(new_message, old_class);
+  return 0;
+}
+
+///
+/// An update with nothing older becomes a record of the updated fields.
+///
+static int MergeTuplesFinal(const data_config *cfg, slice key,
+                            merge_accumulator *oldest_message) {
+  merge_accumulator_set_class(oldest_message, MESSAGE_TYPE_INSERT);
+  return 0;
+}
+
 SplinterDB::SplinterDB(utils::Properties &props, bool preloaded) {
   uint64_t max_key_size = props.GetIntProperty("splinterdb.max_key_size");
+  max_value_size = props.GetIntProperty("splinterdb.max_value_size");
 
   default_data_config_init(max_key_size, &data_cfg);
+  data_cfg.merge_tuples       = MergeTuples;
+  data_cfg.merge_tuples_final = MergeTuplesFinal;
+  update_messages = props.GetIntProperty("splinterdb.update_messages");
+  bounded_scans = props.GetIntProperty("splinterdb.bounded_scans");
+  use_stats = props.GetIntProperty("splinterdb.use_stats");
   splinterdb_cfg.filename                 = props.GetProperty("splinterdb.filename").c_str();
   splinterdb_cfg.cache_size               = props.GetIntProperty("splinterdb.cache_size_mb") * 1024 *1024;
   splinterdb_cfg.disk_size                = props.GetIntProperty("splinterdb.disk_size_gb") * 1024 * 1024 * 1024;
@@ -61,10 +115,31 @@ SplinterDB::~SplinterDB()
 void SplinterDB::Init()
 {
   splinterdb_register_thread(spl);
+  // Values up to max_value_size are looked up without allocating
+  ThreadState *state = new ThreadState;
+  state->lookup_buffer.resize(max_value_size);
+  splinterdb_lookup_result_init(spl, &state->lookup_result,
+                                state->lookup_buffer.size(), state->lookup_buffer.data());
+  thread_states_[this] = state;
+  cached_owner_ = this;
+  cached_state_ = state;
 }
 
 void SplinterDB::Close()
 {
+  ThreadState *state = GetThreadState();
+  splinterdb_lookup_result_deinit(&state->lookup_result);
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    iterator_init_ns.Merge(state->iterator_init_ns);
+    iterator_deinit_ns.Merge(state->iterator_deinit_ns);
+    scan_record_ns.Merge(state->scan_record_ns);
+  }
+  delete state;
+  thread_states_.erase(this);
+  if (cached_owner_ == this) {
+    cached_owner_ = NULL;
+  }
   splinterdb_deregister_thread(spl);
 }
 
@@ -72,17 +147,17 @@ int SplinterDB::Read(const string &table,
                      const string &key,
                      const vector<string> *fields,
                      vector<KVPair> &result) {
-  splinterdb_lookup_result  lookup_result;
-  splinterdb_lookup_result_init(spl, &lookup_result, 0, NULL);
+  splinterdb_lookup_result *lookup_result = &GetThreadState()->lookup_result;
   slice key_slice = slice_create(key.size(), key.c_str());
   //cout << "lookup " << key << endl;
-  assert(!splinterdb_lookup(spl, key_slice, &lookup_result));
-  if (!splinterdb_lookup_found(&lookup_result)) {
-    cout << "FAILED lookup " << key << endl;
-    assert(0);
+  assert(!splinterdb_lookup(spl, key_slice, lookup_result));
+  if (!splinterdb_lookup_found(lookup_result)) {
+    return DB::kErrorNoData;
   }
   //cout << "done lookup " << key << endl;
-  splinterdb_lookup_result_deinit(&lookup_result);
+  slice value;
+  assert(!splinterdb_lookup_result_value(lookup_result, &value));
+  RecordCodec::Decode((const char *)slice_data(value), slice_length(value), fields, result);
   return DB::kOK;
 }
 
@@ -90,22 +165,47 @@ int SplinterDB::Scan(const string &table,
                      const string &key, int len,
                      const vector<string> *fields,
                      vector<vector<KVPair>> &result) {
-  assert(fields == NULL);
-
+  typedef std::chrono::steady_clock Clock;
+  ThreadState *state = GetThreadState();
   slice key_slice = slice_create(key.size(), key.c_str());
 
+  // Iterators are not kept across scans: there is no way to reposition
+  // one, and an open iterator holds back memtable and trunk reclamation.
+  const string &bound = state->scan_bound;
+  bool bounded = bounded_scans && ScanUpperBound(key, len, state->scan_bound);
+
+  Clock::time_point start = Clock::now();
   splinterdb_iterator *itor;
   assert(!splinterdb_iterator_init(spl, &itor, key_slice));
-  for (int i = 0; i < len; i++) {
+  Clock::time_point first = Clock::now();
+  int i;
+  for (i = 0; i < len; i++) {
     if (!splinterdb_iterator_valid(itor)) {
       break;
     }
     slice key, val;
     splinterdb_iterator_get_current(itor, &key, &val);
+    if (bounded && bound.compare(0, string::npos, (const char *)slice_data(key),
+                                 slice_length(key)) <= 0) {
+      break;
+    }
+    result.emplace_back();
+    RecordCodec::Decode((const char *)slice_data(val), slice_length(val), fields, result.back());
     splinterdb_iterator_next(itor);
   }
   assert(!splinterdb_iterator_status(itor));
+  Clock::time_point last = Clock::now();
   splinterdb_iterator_deinit(itor);
+  Clock::time_point end = Clock::now();
+
+  auto ns = [](Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+  };
+  state->iterator_init_ns.Record(ns(first - start));
+  if (i > 0) {
+    state->scan_record_ns.Record(ns(last - first) / i);
+  }
+  state->iterator_deinit_ns.Record(ns(end - last));
 
   return DB::kOK;
 }
@@ -113,13 +213,41 @@ int SplinterDB::Scan(const string &table,
 int SplinterDB::Update(const string &table,
                        const string &key,
                        vector<KVPair> &values) {
-  return Insert(table, key, values);
+  if (!update_messages) {
+    return ReadPatchWrite(key, values);
+  }
+
+  // Blind update: the fields are merged into the record by MergeTuples
+  string &delta = GetThreadState()->value_buffer;
+  RecordCodec::Encode(values, delta);
+  slice key_slice = slice_create(key.size(), key.c_str());
+  slice delta_slice = slice_create(delta.size(), delta.c_str());
+  assert(!splinterdb_update(spl, key_slice, delta_slice));
+
+  return DB::kOK;
 }
 
-int SplinterDB::Insert(const string &table, const string &key, vector<KVPair> &values) {
-  assert(values.size() == 1);
+int SplinterDB::ReadPatchWrite(const string &key, vector<KVPair> &values) {
+  ThreadState *state = GetThreadState();
+  slice key_slice = slice_create(key.size(), key.c_str());
+  assert(!splinterdb_lookup(spl, key_slice, &state->lookup_result));
+  if (!splinterdb_lookup_found(&state->lookup_result)) {
+    return Insert("", key, values);
+  }
+  slice value;
+  assert(!splinterdb_lookup_result_value(&state->lookup_result, &value));
+  string &record = state->value_buffer;
+  record.assign((const char *)slice_data(value), slice_length(value));
+  RecordCodec::Apply(record, values);
+  slice val_slice = slice_create(record.size(), record.c_str());
+  assert(!splinterdb_insert(spl, key_slice, val_slice));
+
+  return DB::kOK;
+}
 
-  std::string val = values[0].second;
+int SplinterDB::Insert(const string &table, const string &key, vector<KVPair> &values) {
+  string &val = GetThreadState()->value_buffer;
+  RecordCodec::Encode(values, val);
   slice key_slice = slice_create(key.size(), key.c_str());
   slice val_slice = slice_create(val.size(), val.c_str());
   //cout << "insert " << key << endl;
@@ -136,4 +264,54 @@ int SplinterDB::Delete(const string &table, const string &key) {
   return DB::kOK;
 }
 
+void SplinterDB::PrintStats(std::ostream &out) {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  if (iterator_init_ns.Count() > 0) {
+    out << "# SplinterDB scan costs (us): count avg p50 p99 p99.9 max" << endl;
+    const std::pair<const char *, utils::Histogram *> rows[] = {
+      {"iterator_init", &iterator_init_ns},
+      {"per_record", &scan_record_ns},
+      {"iterator_deinit", &iterator_deinit_ns},
+    };
+    for (auto &row : rows) {
+      out << row.first << '\t' << row.second->Count() << '\t';
+      row.second->PrintSummary(out, 1000);
+      out << endl;
+    }
+  }
+  iterator_init_ns.Reset();
+  iterator_deinit_ns.Reset();
+  scan_record_ns.Reset();
+
+  if (use_stats) {
+    // SplinterDB prints its statistics to its info log stream: point the
+    // stream at a temporary file to send them along with the other results,
+    // which leaves the output of other threads on stdout. Resetting them
+    // after each phase makes every report cover a single phase. Cache hits
+    // and misses are not reported, as the public API has no call for them.
+    out << "# SplinterDB statistics" << endl;
+    FILE *capture = tmpfile();
+    if (!capture) {
+      out << "# (no temporary file to capture them: printed to stdout)" << endl;
+      splinterdb_stats_print_insertion(spl);
+      splinterdb_stats_print_lookup(spl);
+      fflush(stdout);
+    } else {
+      platform_set_log_streams(capture, stderr);
+      splinterdb_stats_print_insertion(spl);
+      splinterdb_stats_print_lookup(spl);
+      platform_set_log_streams(stdout, stderr);
+      rewind(capture);
+      char buffer[4096];
+      size_t n;
+      while ((n = fread(buffer, 1, sizeof(buffer), capture)) > 0) {
+        out.write(buffer, n);
+      }
+      fclose(capture);
+    }
+    splinterdb_stats_reset(spl);
+    out << "# End of SplinterDB statistics" << endl;
+  }
+}
+
 } // ycsbc
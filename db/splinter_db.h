@@ -9,7 +9,11 @@
 #include "core/db.h"
 
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/histogram.h"
 #include "core/properties.h"
 
 extern "C" {
@@ -45,10 +49,56 @@ public:
 
   int Delete(const std::string &table, const std::string &key);
 
+  void PrintStats(std::ostream &out);
+
 private:
+  ///
+  /// State of a client thread, set up by Init() and reused by every
+  /// operation of the thread.
+  ///
+  struct ThreadState {
+    splinterdb_lookup_result lookup_result;
+    std::vector<char>        lookup_buffer;
+    std::string              value_buffer; /// Encoded record or update
+    std::string              scan_bound;
+    utils::Histogram         iterator_init_ns;
+    utils::Histogram         iterator_deinit_ns;
+    utils::Histogram         scan_record_ns; /// Average per record of each scan
+  };
+
+  ///
+  /// Updates fields by overwriting the whole record.
+  ///
+  int ReadPatchWrite(const std::string &key, std::vector<KVPair> &values);
+
+  ///
+  /// The state of the calling thread, looked up in thread_states_ only when
+  /// the thread last used another instance.
+  ///
+  ThreadState *GetThreadState() {
+    if (cached_owner_ != this) {
+      cached_state_ = thread_states_.at(this);
+      cached_owner_ = this;
+    }
+    return cached_state_;
+  }
+
+  static thread_local std::unordered_map<const SplinterDB *, ThreadState *> thread_states_;
+  static thread_local const SplinterDB *cached_owner_;
+  static thread_local ThreadState *cached_state_;
+
   splinterdb_config         splinterdb_cfg;
   data_config               data_cfg;
   splinterdb               *spl;
+  uint64_t                  max_value_size;
+  bool                      update_messages; /// Update through splinterdb_update, or read-patch-write
+  bool                      bounded_scans;   /// Stop scans past the last record number
+  bool                      use_stats;       /// Report SplinterDB's statistics per phase
+
+  std::mutex                stats_mutex;     /// Guards the histograms below
+  utils::Histogram          iterator_init_ns;
+  utils::Histogram          iterator_deinit_ns;
+  utils::Histogram          scan_record_ns;
 };
 
 } // ycsbc
@@ -0,0 +1,26 @@
+//
+//  striped_stl_db.h
+//  YCSB-C
+//
+//  The hashtable DB of LockStlDB with its global lock on keys replaced by
+//  lock striping. Records keep a lock of their own for their fields.
+//
+
+#ifndef YCSB_C_STRIPED_STL_DB_H_
+#define YCSB_C_STRIPED_STL_DB_H_
+
+#include "db/lock_stl_db.h"
+
+#include "lib/striped_stl_hashtable.h"
+
+namespace ycsbc {
+
+class StripedStlDB : public LockStlDB {
+ public:
+  StripedStlDB(std::size_t num_stripes) : LockStlDB(
+      new vmp::StripedStlHashtable<HashtableDB::FieldHashtable *>(num_stripes)) { }
+};
+
+} // ycsbc
+
+#endif // YCSB_C_STRIPED_STL_DB_H_
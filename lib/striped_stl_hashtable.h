@@ -0,0 +1,182 @@
+//
+//  striped_stl_hashtable.h
+//  YCSB-C
+//
+//  A hashtable split into stripes, each an STL hashtable with its own lock,
+//  so that threads contend only when their keys fall into the same stripe.
+//  Stripes are cache-line aligned so that their locks do not share lines.
+//
+
+#ifndef YCSB_C_LIB_STRIPED_STL_HASHTABLE_H_
+#define YCSB_C_LIB_STRIPED_STL_HASHTABLE_H_
+
+#include "lib/string_hashtable.h"
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "lib/string.h"
+
+namespace vmp {
+
+template<class V>
+class StripedStlHashtable : public StringHashtable<V> {
+ public:
+  typedef typename StringHashtable<V>::KVPair KVPair;
+
+  ///
+  /// The number of stripes is rounded up to a power of two.
+  ///
+  StripedStlHashtable(std::size_t num_stripes = 256);
+  ~StripedStlHashtable();
+
+  V Get(const char *key) const; ///< Returns NULL if the key is not found
+  bool Insert(const char *key, V value);
+  V Update(const char *key, V value);
+  V Remove(const char *key);
+
+  ///
+  /// Entries from key on, in the order of its stripe then of the following
+  /// ones, locking one stripe at a time.
+  ///
+  std::vector<KVPair> Entries(const char *key = NULL, std::size_t n = -1) const;
+  std::size_t Size() const;
+
+ private:
+  struct Hash {
+    uint64_t operator()(const String &hstr) const { return hstr.hash(); }
+  };
+
+  struct Equal {
+    bool operator()(const String &a, const String &b) const { return a == b; }
+  };
+
+  typedef std::unordered_map<String, V, Hash, Equal> Hashtable;
+
+  struct alignas(64) Stripe {
+    mutable std::mutex mutex;
+    Hashtable table;
+  };
+
+  ///
+  /// Picks a stripe from the high bits of the mixed hash, as the tables
+  /// bucket by its low bits.
+  ///
+  std::size_t StripeOf(const String &key) const {
+    return (key.hash() * 0x9E3779B97F4A7C15ULL) >> (64 - stripe_bits_);
+  }
+
+  int stripe_bits_;
+  std::size_t num_stripes_;
+  std::unique_ptr<Stripe[]> stripes_;
+};
+
+template<class V>
+StripedStlHashtable<V>::StripedStlHashtable(std::size_t n) : stripe_bits_(1) {
+  while (((std::size_t)1 << stripe_bits_) < n) {
+    stripe_bits_++;
+  }
+  num_stripes_ = (std::size_t)1 << stripe_bits_;
+  stripes_.reset(new Stripe[num_stripes_]);
+}
+
+template<class V>
+StripedStlHashtable<V>::~StripedStlHashtable() {
+  for (std::size_t i = 0; i < num_stripes_; ++i) {
+    for (auto &pair : stripes_[i].table) {
+      String::Free<MemAlloc>(pair.first);
+    }
+  }
+}
+
+template<class V>
+V StripedStlHashtable<V>::Get(const char *key) const {
+  String skey = String::Wrap(key);
+  const Stripe &stripe = stripes_[StripeOf(skey)];
+  std::lock_guard<std::mutex> lock(stripe.mutex);
+  typename Hashtable::const_iterator pos = stripe.table.find(skey);
+  if (pos == stripe.table.end()) return NULL;
+  else return pos->second;
+}
+
+template<class V>
+bool StripedStlHashtable<V>::Insert(const char *key, V value) {
+  if (!key) return false;
+  String skey = String::Copy<MemAlloc>(key);
+  Stripe &stripe = stripes_[StripeOf(skey)];
+  bool inserted;
+  {
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    inserted = stripe.table.insert(std::make_pair(skey, value)).second;
+  }
+  if (!inserted) String::Free<MemAlloc>(skey);
+  return inserted;
+}
+
+template<class V>
+V StripedStlHashtable<V>::Update(const char *key, V value) {
+  String skey = String::Wrap(key);
+  Stripe &stripe = stripes_[StripeOf(skey)];
+  std::lock_guard<std::mutex> lock(stripe.mutex);
+  typename Hashtable::iterator pos = stripe.table.find(skey);
+  if (pos == stripe.table.end()) return NULL;
+  V old = pos->second;
+  pos->second = value;
+  return old;
+}
+
+template<class V>
+V StripedStlHashtable<V>::Remove(const char *key) {
+  String skey = String::Wrap(key);
+  Stripe &stripe = stripes_[StripeOf(skey)];
+  String removed;
+  V old;
+  {
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    typename Hashtable::const_iterator pos = stripe.table.find(skey);
+    if (pos == stripe.table.end()) return NULL;
+    removed = pos->first;
+    old = pos->second;
+    stripe.table.erase(pos);
+  }
+  String::Free<MemAlloc>(removed);
+  return old;
+}
+
+template<class V>
+std::vector<typename StripedStlHashtable<V>::KVPair>
+StripedStlHashtable<V>::Entries(const char *key, std::size_t n) const {
+  std::vector<KVPair> pairs;
+  std::size_t first = 0;
+  if (key) {
+    first = StripeOf(String::Wrap(key));
+  }
+  for (std::size_t i = first; i < num_stripes_ && pairs.size() < n; ++i) {
+    const Stripe &stripe = stripes_[i];
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    typename Hashtable::const_iterator pos = stripe.table.cbegin();
+    if (key && i == first) {
+      pos = stripe.table.find(String::Wrap(key));
+      if (pos == stripe.table.end()) break;
+    }
+    for (; pos != stripe.table.end() && pairs.size() < n; ++pos) {
+      pairs.push_back(std::make_pair(pos->first.value(), pos->second));
+    }
+  }
+  return pairs;
+}
+
+template<class V>
+std::size_t StripedStlHashtable<V>::Size() const {
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < num_stripes_; ++i) {
+    std::lock_guard<std::mutex> lock(stripes_[i].mutex);
+    size += stripes_[i].table.size();
+  }
+  return size;
+}
+
+} // vmp
+
+#endif // YCSB_C_LIB_STRIPED_STL_HASHTABLE_H_
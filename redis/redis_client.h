@@ -5,18 +5,73 @@
 #ifndef YCSB_C_REDIS_CLIENT_H_
 #define YCSB_C_REDIS_CLIENT_H_
 
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
 #include "redis/hiredis/hiredis.h"
 
 namespace ycsbc {
 
+///
+/// Arguments of a command, pointing into the buffers they were added from,
+/// which must outlive the call sending them. Arguments are binary-safe, and
+/// reusing the same RedisArgs for the commands of a thread avoids
+/// allocations.
+///
+class RedisArgs {
+ public:
+  void Clear() {
+    argv_.clear();
+    argvlen_.clear();
+  }
+
+  RedisArgs &Add(const char *arg, size_t len) {
+    argv_.push_back(arg);
+    argvlen_.push_back(len);
+    return *this;
+  }
+
+  RedisArgs &Add(const char *arg) { return Add(arg, strlen(arg)); }
+  RedisArgs &Add(const std::string &arg) { return Add(arg.data(), arg.size()); }
+
+  int argc() const { return argv_.size(); }
+  const char **argv() { return argv_.data(); }
+  const size_t *argvlen() const { return argvlen_.data(); }
+
+ private:
+  std::vector<const char *> argv_;
+  std::vector<size_t> argvlen_;
+};
+
 class RedisClient {
  public:
   RedisClient(const char *host, int port, int slaves);
   ~RedisClient();
 
-  int Command(std::string cmd);
+  ///
+  /// Sends a command and waits for its reply, and for the slaves if any.
+  ///
+  int Command(RedisArgs &args);
+
+  ///
+  /// Appends a command to the context, to be sent with the next read of a
+  /// reply.
+  ///
+  void Append(RedisArgs &args) {
+    redisAppendCommandArgv(context_, args.argc(), args.argv(), args.argvlen());
+  }
+
+  ///
+  /// Reads the reply to the oldest command appended to the context. The
+  /// caller frees it.
+  ///
+  redisReply *GetReply(const char *hint);
+
+  ///
+  /// Appends a WAIT for the slaves, if any. Returns whether it did.
+  ///
+  bool AppendWait();
 
   redisContext *context() { return context_; }
  private:
@@ -24,13 +79,14 @@ class RedisClient {
 
   redisContext *context_;
   int slaves_;
+  std::string slaves_arg_; /// slaves_ as the argument of WAIT
 };
 
 //
 // Implementation
 //
 inline RedisClient::RedisClient(const char *host, int port, int slaves) :
-    slaves_(slaves) {
+    slaves_(slaves), slaves_arg_(std::to_string(slaves)) {
   context_ = redisConnect(host, port);
   if (!context_ || context_->err) {
     if (context_) {
@@ -49,23 +105,31 @@ inline RedisClient::~RedisClient() {
   }
 }
 
-inline int RedisClient::Command(std::string cmd) {
-  redisReply *reply;
-  redisAppendCommand(context_, cmd.data());
-  if (slaves_) {
-    redisAppendCommand(context_, "WAIT %d %d", slaves_, 0);
+inline int RedisClient::Command(RedisArgs &args) {
+  Append(args);
+  bool wait = AppendWait();
+  freeReplyObject(GetReply(args.argv()[0]));
+  if (wait) {
+    freeReplyObject(GetReply("WAIT"));
   }
+  return 0;
+}
+
+inline redisReply *RedisClient::GetReply(const char *hint) {
+  redisReply *reply = NULL;
   if (redisGetReply(context_, (void **)&reply) == REDIS_ERR) {
-    HandleError(reply, cmd.c_str());
+    HandleError(reply, hint);
   }
-  freeReplyObject(reply);
+  return reply;
+}
+
+inline bool RedisClient::AppendWait() {
   if (slaves_) {
-    if (redisGetReply(context_, (void **)&reply) == REDIS_ERR) {
-      HandleError(reply, "WAIT");
-    }
-    freeReplyObject(reply);
+    // Without argument lengths, hiredis takes them with strlen
+    const char *argv[] = {"WAIT", slaves_arg_.c_str(), "0"};
+    redisAppendCommandArgv(context_, 3, argv, NULL);
   }
-  return 0;
+  return slaves_;
 }
 
 inline void RedisClient::HandleError(redisReply *reply, const char *hint) {
@@ -0,0 +1,84 @@
+//
+// A minimal event loop for a hiredis async context, polling its socket.
+// Each client thread runs its own, until the replies it waits for arrive.
+//
+
+#ifndef YCSB_C_REDIS_POLL_LOOP_H_
+#define YCSB_C_REDIS_POLL_LOOP_H_
+
+#include <poll.h>
+#include "redis/hiredis/async.h"
+
+namespace ycsbc {
+
+class RedisPollLoop {
+ public:
+  RedisPollLoop() : context_(NULL), fd_(-1), reading_(false), writing_(false) { }
+
+  ///
+  /// Attaches the loop to a context, which it must outlive.
+  ///
+  int Attach(redisAsyncContext *ac) {
+    if (ac->ev.data != NULL) {
+      return REDIS_ERR;
+    }
+    context_ = ac;
+    fd_ = ac->c.fd;
+    ac->ev.addRead = AddRead;
+    ac->ev.delRead = DelRead;
+    ac->ev.addWrite = AddWrite;
+    ac->ev.delWrite = DelWrite;
+    ac->ev.cleanup = Cleanup;
+    ac->ev.data = this;
+    return REDIS_OK;
+  }
+
+  ///
+  /// Waits for the socket to be ready and handles its events once. Returns
+  /// false once the context is gone, when no event can come anymore.
+  ///
+  bool RunOnce() {
+    if (!context_) {
+      return false;
+    }
+    if (!reading_ && !writing_) {
+      return true;
+    }
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = (reading_ ? POLLIN : 0) | (writing_ ? POLLOUT : 0);
+    pfd.revents = 0;
+    if (poll(&pfd, 1, -1) <= 0) {
+      return true;
+    }
+    // Handling an event may free the context, which detaches the loop
+    if (pfd.revents & (POLLIN | POLLERR | POLLHUP)) {
+      redisAsyncHandleRead(context_);
+    }
+    if (context_ && (pfd.revents & POLLOUT)) {
+      redisAsyncHandleWrite(context_);
+    }
+    return context_ != NULL;
+  }
+
+ private:
+  static void AddRead(void *data) { static_cast<RedisPollLoop *>(data)->reading_ = true; }
+  static void DelRead(void *data) { static_cast<RedisPollLoop *>(data)->reading_ = false; }
+  static void AddWrite(void *data) { static_cast<RedisPollLoop *>(data)->writing_ = true; }
+  static void DelWrite(void *data) { static_cast<RedisPollLoop *>(data)->writing_ = false; }
+
+  static void Cleanup(void *data) {
+    RedisPollLoop *loop = static_cast<RedisPollLoop *>(data);
+    loop->context_ = NULL;
+    loop->reading_ = loop->writing_ = false;
+  }
+
+  redisAsyncContext *context_;
+  int fd_;
+  bool reading_;
+  bool writing_;
+};
+
+} // namespace ycsbc
+
+#endif // YCSB_C_REDIS_POLL_LOOP_H_
@@ -0,0 +1,153 @@
+//
+//  redis_router.h
+//  YCSB-C
+//
+//  Routing of keys to a list of Redis servers, for client-side sharding.
+//  With "hash" routing, keys go to the first of vnodes points per server
+//  on a consistent hash ring, so adding a server moves about 1/N of the
+//  keys. With "slots" routing, keys go to the CRC16 hash slot Redis Cluster
+//  would pick, honoring {hash tags}, and the 16384 slots are split into
+//  even contiguous ranges, one per server.
+//
+
+#ifndef YCSB_C_REDIS_ROUTER_H_
+#define YCSB_C_REDIS_ROUTER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "core/utils.h"
+
+namespace ycsbc {
+
+class RedisRouter {
+ public:
+  struct Endpoint {
+    std::string host;
+    int port;
+    std::string name; /// host:port
+  };
+
+  static const int kSlots = 16384;
+
+  ///
+  /// Parses endpoints, a comma-separated list of host:port, falling back to
+  /// a single server at host and port if it is empty.
+  ///
+  RedisRouter(const std::string &endpoints, const std::string &host, int port,
+              const std::string &routing, int vnodes);
+
+  size_t NumEndpoints() const { return endpoints_.size(); }
+  const Endpoint &endpoint(size_t i) const { return endpoints_[i]; }
+
+  ///
+  /// The index of the endpoint holding key.
+  ///
+  size_t Route(const std::string &key) const {
+    if (endpoints_.size() == 1) {
+      return 0;
+    }
+    if (slot_routing_) {
+      return (size_t)Slot(key) * endpoints_.size() / kSlots;
+    }
+    uint64_t hash = HashKey(key.data(), key.size());
+    auto point = std::lower_bound(ring_.begin(), ring_.end(),
+                                  std::make_pair(hash, (size_t)0));
+    return point == ring_.end() ? ring_.front().second : point->second;
+  }
+
+  ///
+  /// The Redis Cluster hash slot of key: CRC16 of the key, or of its hash
+  /// tag (the part between the first '{' and the next '}', if not empty),
+  /// modulo kSlots.
+  ///
+  static uint16_t Slot(const std::string &key) {
+    size_t open = key.find('{');
+    if (open != std::string::npos) {
+      size_t close = key.find('}', open + 1);
+      if (close != std::string::npos && close > open + 1) {
+        return Crc16(key.data() + open + 1, close - open - 1) % kSlots;
+      }
+    }
+    return Crc16(key.data(), key.size()) % kSlots;
+  }
+
+  ///
+  /// CRC16-CCITT (XMODEM), as used by Redis Cluster.
+  ///
+  static uint16_t Crc16(const char *data, size_t len) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; ++i) {
+      crc ^= (uint16_t)(unsigned char)data[i] << 8;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+    }
+    return crc;
+  }
+
+ private:
+  ///
+  /// FNV-1a over the bytes, finished with a 64-bit mix so that similar keys
+  /// spread over the ring.
+  ///
+  static uint64_t HashKey(const char *data, size_t len) {
+    uint64_t hash = utils::kFNVOffsetBasis64;
+    for (size_t i = 0; i < len; ++i) {
+      hash ^= (unsigned char)data[i];
+      hash *= utils::kFNVPrime64;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    return hash;
+  }
+
+  std::vector<Endpoint> endpoints_;
+  bool slot_routing_;
+  std::vector<std::pair<uint64_t, size_t>> ring_; /// Sorted points and their endpoints
+};
+
+//
+// Implementation
+//
+inline RedisRouter::RedisRouter(const std::string &endpoints, const std::string &host,
+                                int port, const std::string &routing, int vnodes) {
+  std::stringstream list(endpoints);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    item = utils::Trim(item);
+    size_t colon = item.rfind(':');
+    if (item.empty() || colon == std::string::npos || colon == 0) {
+      throw utils::Exception("redis.endpoints needs a list of host:port, got: " + item);
+    }
+    endpoints_.push_back({item.substr(0, colon), std::stoi(item.substr(colon + 1)), item});
+  }
+  if (endpoints_.empty()) {
+    endpoints_.push_back({host, port, host + ":" + std::to_string(port)});
+  }
+
+  if (routing != "hash" && routing != "slots") {
+    throw utils::Exception("Unknown redis.routing: " + routing);
+  }
+  slot_routing_ = routing == "slots";
+  if (!slot_routing_) {
+    if (vnodes <= 0) {
+      throw utils::Exception("redis.vnodes must be positive");
+    }
+    for (size_t i = 0; i < endpoints_.size(); ++i) {
+      for (int v = 0; v < vnodes; ++v) {
+        std::string point = endpoints_[i].name + "#" + std::to_string(v);
+        ring_.emplace_back(HashKey(point.data(), point.size()), i);
+      }
+    }
+    std::sort(ring_.begin(), ring_.end());
+  }
+}
+
+} // ycsbc
+
+#endif // YCSB_C_REDIS_ROUTER_H_
@@ -13,9 +13,15 @@ int main(int argc, const char *argv[]) {
 
   RedisClient client(host, port, 0);
 
-  client.Command("HMSET Ren field1 jinglei@ren.systems field2 Jinglei");
-
-  RedisDB db(host, port, false);
+  RedisArgs args;
+  args.Add("HMSET").Add("Ren").Add("field1").Add("jinglei@ren.systems")
+      .Add("field2").Add("Jinglei");
+  client.Command(args);
+
+  utils::Properties props;
+  props.SetProperty("host", host);
+  props.SetProperty("port", to_string(port));
+  RedisDB db(props);
   db.Init();
   string key = "Ren";
   vector<string> fields;
@@ -3,6 +3,7 @@
 repeat_num=3
 db_names=(
   "lock_stl"
+  "striped_stl"
   "tbb_rand"
   "tbb_scan"
 )
@@ -0,0 +1,457 @@
+//
+//  trace_convert.cc
+//  YCSB-C
+//
+//  Converts public key-value traces into the binary trace format replayed by
+//  ycsbc (see core/trace.h and the "tracefile" workload property).
+//
+//  The input is streamed in fixed-size chunks split at line boundaries.
+//  Worker threads parse chunks in parallel and a writer thread emits the
+//  converted chunks in input order, so memory use is bounded by
+//  chunk size * in-flight chunks regardless of the trace size.
+//
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <iostream>
+#include <map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "core/trace.h"
+#include "core/timer.h"
+
+using namespace std;
+using ycsbc::TraceOp;
+
+typedef enum trace_format {
+  twitter_format, // timestamp,key,key_size,value_size,client_id,op,ttl
+  rocksdb_format, // trace_analyzer human readable: key type cf_id value_size timestamp
+  csv_format,     // timestamp,key,op,size
+} trace_format;
+
+struct Chunk {
+  uint64_t seq;
+  vector<char> input;
+  string output;
+  uint64_t records;
+  uint64_t skipped;
+};
+
+struct Options {
+  trace_format format;
+  bool hex_keys;
+  unsigned int threads;
+  size_t chunk_size;
+};
+
+void UsageMessage(const char *command);
+
+static inline bool ParseUInt(const char *begin, const char *end, uint64_t *value) {
+  if (begin == end) return false;
+  uint64_t v = 0;
+  for (const char *p = begin; p < end; ++p) {
+    if (*p < '0' || *p > '9') return false;
+    v = v * 10 + (*p - '0');
+  }
+  *value = v;
+  return true;
+}
+
+static inline bool TokenIs(const char *begin, const char *end, const char *word) {
+  size_t len = strlen(word);
+  if ((size_t)(end - begin) != len) return false;
+  for (size_t i = 0; i < len; ++i) {
+    if (tolower(begin[i]) != word[i]) return false;
+  }
+  return true;
+}
+
+static inline int HexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+///
+/// Splits [begin, end) at the last `count` occurrences of `sep`.
+/// On success, fields[0] is everything before them (the key may contain the
+/// separator) and fields[1..count] are the trailing fields.
+///
+static inline bool SplitTail(const char *begin, const char *end, char sep,
+                             int count, const char **starts, const char **ends) {
+  const char *field_end = end;
+  for (int i = count; i > 0; --i) {
+    const char *p = field_end;
+    while (p > begin && p[-1] != sep) --p;
+    if (p == begin) return false;
+    starts[i] = p;
+    ends[i] = field_end;
+    field_end = p - 1;
+  }
+  starts[0] = begin;
+  ends[0] = field_end;
+  return true;
+}
+
+static bool ParseTwitter(const char *begin, const char *end, string &out) {
+  const char *comma = (const char *)memchr(begin, ',', end - begin);
+  if (!comma) return false;
+  uint64_t ts;
+  if (!ParseUInt(begin, comma, &ts)) return false;
+
+  // key, key_size, value_size, client_id, op, ttl
+  const char *s[6], *e[6];
+  if (!SplitTail(comma + 1, end, ',', 5, s, e)) return false;
+  uint64_t value_size;
+  if (!ParseUInt(s[2], e[2], &value_size)) return false;
+
+  TraceOp op;
+  if (TokenIs(s[4], e[4], "get") || TokenIs(s[4], e[4], "gets")) {
+    op = ycsbc::kTraceRead;
+  } else if (TokenIs(s[4], e[4], "set") || TokenIs(s[4], e[4], "add") ||
+             TokenIs(s[4], e[4], "replace") || TokenIs(s[4], e[4], "cas") ||
+             TokenIs(s[4], e[4], "append") || TokenIs(s[4], e[4], "prepend") ||
+             TokenIs(s[4], e[4], "incr") || TokenIs(s[4], e[4], "decr")) {
+    op = ycsbc::kTraceUpdate;
+  } else if (TokenIs(s[4], e[4], "delete")) {
+    op = ycsbc::kTraceDelete;
+  } else {
+    return false;
+  }
+  if (e[0] - s[0] > UINT16_MAX || value_size > UINT32_MAX) return false;
+  ycsbc::AppendTraceRecord(out, ts * 1000000, op, s[0], e[0] - s[0], value_size);
+  return true;
+}
+
+static bool ParseRocksDB(const char *begin, const char *end, bool hex_keys,
+                         string &out, string &key_buffer) {
+  // key, type, cf_id, value_size, timestamp
+  const char *s[5], *e[5];
+  if (!SplitTail(begin, end, ' ', 4, s, e)) return false;
+  uint64_t type, value_size, ts;
+  if (!ParseUInt(s[1], e[1], &type) || !ParseUInt(s[3], e[3], &value_size) ||
+      !ParseUInt(s[4], e[4], &ts)) {
+    return false;
+  }
+
+  // Operation types of rocksdb's trace_analyzer
+  TraceOp op;
+  switch (type) {
+    case 0: case 8: op = ycsbc::kTraceRead; break;    // Get, MultiGet
+    case 1: case 5: op = ycsbc::kTraceUpdate; break;  // Put, Merge
+    case 2: case 3: op = ycsbc::kTraceDelete; break;  // Delete, SingleDelete
+    case 6: case 7: op = ycsbc::kTraceScan; break;    // Seek, SeekForPrev
+    default: return false;                            // RangeDelete
+  }
+  if (op == ycsbc::kTraceScan) {
+    value_size = 0; // Use the workload's scan length distribution
+  }
+
+  const char *key = s[0];
+  size_t key_size = e[0] - s[0];
+  if (hex_keys) {
+    if (key_size % 2) return false;
+    key_buffer.resize(key_size / 2);
+    for (size_t i = 0; i < key_size / 2; ++i) {
+      int hi = HexDigit(key[2 * i]), lo = HexDigit(key[2 * i + 1]);
+      if (hi < 0 || lo < 0) return false;
+      key_buffer[i] = (char)(hi << 4 | lo);
+    }
+    key = key_buffer.data();
+    key_size = key_buffer.size();
+  }
+  if (key_size > UINT16_MAX || value_size > UINT32_MAX) return false;
+  ycsbc::AppendTraceRecord(out, ts, op, key, key_size, value_size);
+  return true;
+}
+
+static bool ParseCSV(const char *begin, const char *end, string &out) {
+  const char *comma = (const char *)memchr(begin, ',', end - begin);
+  if (!comma) return false;
+  uint64_t ts;
+  if (!ParseUInt(begin, comma, &ts)) return false; // also skips a header line
+
+  // key, op, size
+  const char *s[3], *e[3];
+  if (!SplitTail(comma + 1, end, ',', 2, s, e)) return false;
+  uint64_t size;
+  if (!ParseUInt(s[2], e[2], &size)) return false;
+
+  TraceOp op;
+  if (TokenIs(s[1], e[1], "read") || TokenIs(s[1], e[1], "get")) {
+    op = ycsbc::kTraceRead;
+  } else if (TokenIs(s[1], e[1], "update") || TokenIs(s[1], e[1], "set") ||
+             TokenIs(s[1], e[1], "put")) {
+    op = ycsbc::kTraceUpdate;
+  } else if (TokenIs(s[1], e[1], "insert") || TokenIs(s[1], e[1], "add")) {
+    op = ycsbc::kTraceInsert;
+  } else if (TokenIs(s[1], e[1], "scan")) {
+    op = ycsbc::kTraceScan;
+  } else if (TokenIs(s[1], e[1], "delete") || TokenIs(s[1], e[1], "del")) {
+    op = ycsbc::kTraceDelete;
+  } else {
+    return false;
+  }
+  if (e[0] - s[0] > UINT16_MAX || size > UINT32_MAX) return false;
+  ycsbc::AppendTraceRecord(out, ts, op, s[0], e[0] - s[0], size);
+  return true;
+}
+
+static void ConvertChunk(const Options &opts, Chunk *chunk) {
+  string key_buffer;
+  const char *p = chunk->input.data();
+  const char *limit = p + chunk->input.size();
+  chunk->output.clear();
+  chunk->output.reserve(chunk->input.size());
+  chunk->records = chunk->skipped = 0;
+
+  while (p < limit) {
+    const char *eol = (const char *)memchr(p, '\n', limit - p);
+    if (!eol) eol = limit;
+    const char *end = eol;
+    if (end > p && end[-1] == '\r') --end;
+    if (end > p) {
+      bool ok = false;
+      switch (opts.format) {
+        case twitter_format: ok = ParseTwitter(p, end, chunk->output); break;
+        case rocksdb_format: ok = ParseRocksDB(p, end, opts.hex_keys, chunk->output, key_buffer); break;
+        case csv_format: ok = ParseCSV(p, end, chunk->output); break;
+      }
+      if (ok) chunk->records++;
+      else chunk->skipped++;
+    }
+    p = eol + 1;
+  }
+}
+
+class Converter {
+ public:
+  Converter(const Options &opts, FILE *in, FILE *out) :
+      opts_(opts), in_(in), out_(out), in_flight_(0), next_write_(0),
+      done_reading_(false), records_(0), skipped_(0) { }
+
+  void Run();
+  uint64_t records() const { return records_; }
+  uint64_t skipped() const { return skipped_; }
+
+ private:
+  void Work();
+  void Write();
+
+  const Options &opts_;
+  FILE *in_;
+  FILE *out_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;  ///< Signals chunks to parse
+  std::condition_variable done_cv_;  ///< Signals parsed chunks to write
+  std::condition_variable slot_cv_;  ///< Signals room for another chunk
+  deque<Chunk *> work_;
+  map<uint64_t, Chunk *> done_;
+  unsigned int in_flight_;
+  uint64_t next_write_;
+  bool done_reading_;
+
+  uint64_t records_;
+  uint64_t skipped_;
+};
+
+void Converter::Run() {
+  vector<thread> workers;
+  for (unsigned int i = 0; i < opts_.threads; ++i) {
+    workers.emplace_back(&Converter::Work, this);
+  }
+  thread writer(&Converter::Write, this);
+
+  const unsigned int max_in_flight = 2 * opts_.threads;
+  vector<char> carry;
+  uint64_t seq = 0;
+  bool eof = false;
+  while (!eof) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      slot_cv_.wait(lock, [&]{ return in_flight_ < max_in_flight; });
+      in_flight_++;
+    }
+    Chunk *chunk = new Chunk;
+    chunk->seq = seq++;
+    chunk->input.swap(carry);
+    size_t used = chunk->input.size();
+    chunk->input.resize(used + opts_.chunk_size);
+    size_t n = fread(chunk->input.data() + used, 1, opts_.chunk_size, in_);
+    chunk->input.resize(used + n);
+    eof = n < opts_.chunk_size;
+
+    // Hand a partial trailing line over to the next chunk
+    carry.clear();
+    if (!eof) {
+      size_t last = chunk->input.size();
+      while (last > 0 && chunk->input[last - 1] != '\n') --last;
+      carry.assign(chunk->input.begin() + last, chunk->input.end());
+      chunk->input.resize(last);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    work_.push_back(chunk);
+    work_cv_.notify_one();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_reading_ = true;
+    work_cv_.notify_all();
+  }
+  for (auto &t : workers) {
+    t.join();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_cv_.notify_all();
+  }
+  writer.join();
+}
+
+void Converter::Work() {
+  while (true) {
+    Chunk *chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [&]{ return !work_.empty() || done_reading_; });
+      if (work_.empty()) return;
+      chunk = work_.front();
+      work_.pop_front();
+    }
+    ConvertChunk(opts_, chunk);
+    vector<char>().swap(chunk->input);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    done_[chunk->seq] = chunk;
+    done_cv_.notify_one();
+  }
+}
+
+void Converter::Write() {
+  while (true) {
+    Chunk *chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_cv_.wait(lock, [&]{
+        return done_.count(next_write_) ||
+               (done_reading_ && in_flight_ == 0);
+      });
+      auto it = done_.find(next_write_);
+      if (it == done_.end()) return;
+      chunk = it->second;
+      done_.erase(it);
+    }
+    if (fwrite(chunk->output.data(), 1, chunk->output.size(), out_) !=
+        chunk->output.size()) {
+      perror("trace_convert: write");
+      exit(1);
+    }
+    records_ += chunk->records;
+    skipped_ += chunk->skipped;
+    delete chunk;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    next_write_++;
+    in_flight_--;
+    slot_cv_.notify_one();
+    done_cv_.notify_all();
+  }
+}
+
+int main(const int argc, const char *argv[]) {
+  Options opts;
+  opts.format = csv_format;
+  opts.hex_keys = false;
+  opts.threads = thread::hardware_concurrency() ? thread::hardware_concurrency() : 1;
+  opts.chunk_size = 16 << 20;
+
+  int argindex = 1;
+  while (argindex < argc && argv[argindex][0] == '-') {
+    if (strcmp(argv[argindex], "-format") == 0 && argindex + 1 < argc) {
+      const char *format = argv[argindex + 1];
+      if (strcmp(format, "twitter") == 0) {
+        opts.format = twitter_format;
+      } else if (strcmp(format, "rocksdb") == 0) {
+        opts.format = rocksdb_format;
+      } else if (strcmp(format, "csv") == 0) {
+        opts.format = csv_format;
+      } else {
+        cout << "Unknown trace format '" << format << "'" << endl;
+        exit(0);
+      }
+      argindex += 2;
+    } else if (strcmp(argv[argindex], "-threads") == 0 && argindex + 1 < argc) {
+      opts.threads = max(1, stoi(argv[argindex + 1]));
+      argindex += 2;
+    } else if (strcmp(argv[argindex], "-chunk_mb") == 0 && argindex + 1 < argc) {
+      opts.chunk_size = (size_t)max(1, stoi(argv[argindex + 1])) << 20;
+      argindex += 2;
+    } else if (strcmp(argv[argindex], "-hexkeys") == 0) {
+      opts.hex_keys = true;
+      argindex++;
+    } else {
+      UsageMessage(argv[0]);
+      exit(0);
+    }
+  }
+  if (argindex + 2 != argc) {
+    UsageMessage(argv[0]);
+    exit(0);
+  }
+
+  FILE *in = strcmp(argv[argindex], "-") == 0 ? stdin : fopen(argv[argindex], "rb");
+  if (!in) {
+    perror(argv[argindex]);
+    exit(1);
+  }
+  FILE *out = fopen(argv[argindex + 1], "wb");
+  if (!out) {
+    perror(argv[argindex + 1]);
+    exit(1);
+  }
+
+  ycsbc::TraceHeader header;
+  ycsbc::InitTraceHeader(header);
+  fwrite(&header, sizeof(header), 1, out);
+
+  utils::Timer<double> timer;
+  timer.Start();
+  Converter converter(opts, in, out);
+  converter.Run();
+  double duration = timer.End();
+
+  if (in != stdin) fclose(in);
+  if (fclose(out)) {
+    perror(argv[argindex + 1]);
+    exit(1);
+  }
+
+  cerr << "# Converted records:\t" << converter.records() << endl;
+  cerr << "# Skipped lines:\t" << converter.skipped() << endl;
+  cerr << "# Conversion time (s):\t" << duration << endl;
+  cerr << "Replay it with -w tracefile " << argv[argindex + 1]
+       << " -w operationcount " << converter.records() << endl;
+  return 0;
+}
+
+void UsageMessage(const char *command) {
+  cout << "Usage: " << command << " [options] <input|-> <output.trace>" << endl;
+  cout << "       Convert a key-value trace into the binary format replayed by ycsbc" << endl;
+  cout << "Options:" << endl;
+  cout << "  -format <fmt>: input format (default: csv)" << endl;
+  cout << "      twitter: Twitter cache trace (timestamp,key,key_size,value_size,client_id,op,ttl)" << endl;
+  cout << "      rocksdb: rocksdb trace_analyzer human readable trace (key type cf_id value_size timestamp)" << endl;
+  cout << "      csv:     timestamp,key,op,size" << endl;
+  cout << "  -hexkeys: keys in a rocksdb trace are hex encoded" << endl;
+  cout << "  -threads <n>: parse using <n> threads (default: all cores)" << endl;
+  cout << "  -chunk_mb <n>: read the input in chunks of <n> MB (default: 16)" << endl;
+}
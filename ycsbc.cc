@@ -11,10 +11,14 @@
 #include <iostream>
 #include <vector>
 #include <future>
+#include <chrono>
+#include <thread>
 #include "core/utils.h"
 #include "core/timer.h"
+#include "core/histogram.h"
 #include "core/client.h"
 #include "core/core_workload.h"
+#include "core/zipfian_verifier.h"
 #include "db/db_factory.h"
 
 using namespace std;
@@ -22,9 +26,28 @@ using namespace std;
 typedef struct WorkloadProperties {
   string filename;
   bool preloaded;
+  bool concurrent; /// Runs alongside the preceding Run workload (-C)
   utils::Properties props;
 } WorkloadProperties;
 
+///
+/// A Run workload sharing the database with the other workloads of its
+/// phase, on its own client threads.
+///
+typedef struct Tenant {
+  WorkloadProperties *workload;
+  unsigned int num_threads;
+  ycsbc::CoreWorkload *wls;
+  bool owns_wls; /// False if wls are the workloads of the Load phase
+  ycsbc::BatchedCounterGenerator *key_generator; /// Own key space, or NULL
+  ycsbc::TraceReader *trace;
+  ycsbc::WorkloadSchedule *schedule;
+  utils::Histogram *latency; /// One per thread
+  uint64_t total_ops;
+  uint64_t oks;
+  double duration;
+} Tenant;
+
 std::map<string, string> default_props = {
   {"threadcount", "1"},
   {"dbname", "basic"},
@@ -43,7 +66,11 @@ std::map<string, string> default_props = {
   {"splinterdb.disk_size_gb", "128"},
 
   {"splinterdb.max_key_size", "24"},
+  // Above the ~1.1 KB encoded record of the default 10 fields of 100 bytes
+  {"splinterdb.max_value_size", "4096"},
   {"splinterdb.use_log", "1"},
+  {"splinterdb.update_messages", "1"},
+  {"splinterdb.bounded_scans", "0"},
 
   // All these options use splinterdb's internal defaults
   {"splinterdb.page_size", "0"},
@@ -63,6 +90,40 @@ std::map<string, string> default_props = {
   {"splinterdb.reclaim_threshold", "0"},
 
   {"rocksdb.database_filename", "rocksdb.db"},
+  {"rocksdb.merge_updates", "0"},
+  {"rocksdb.statistics", "0"},
+  {"rocksdb.perf_sample_rate", "0"},
+  {"rocksdb.bounded_scans", "0"},
+  {"rocksdb.transactions", "none"},
+  {"rocksdb.transaction_retries", "3"},
+  {"rocksdb.transaction_lock_timeout_ms", "1000"},
+  {"rocksdb.scan_readahead_kb", "0"},
+  {"rocksdb.scan_pin_data", "0"},
+  {"rocksdb.prefix_length", "0"},
+  {"rocksdb.bulk_load", "0"},
+  {"rocksdb.bulk_load_buffer_mb", "256"},
+
+  //
+  // sharded config defaults
+  //
+  {"sharded.shards", "1"},
+  {"sharded.routing", "hash"},
+  {"sharded.workers", "0"},
+
+  //
+  // striped_stl config defaults
+  //
+  {"striped.stripes", "256"},
+
+  //
+  // redis config defaults
+  //
+  {"redis.pipeline_depth", "0"},
+  {"redis.scan_index", "0"},
+  {"redis.scan_script", "0"},
+  {"redis.max_inflight", "0"},
+  {"redis.routing", "hash"},
+  {"redis.vnodes", "160"},
 };
 
 
@@ -70,6 +131,7 @@ void UsageMessage(const char *command);
 bool StrStartWith(const char *str, const char *pre);
 void ParseCommandLine(int argc, const char *argv[], utils::Properties &props,
                       WorkloadProperties &load_workload, vector<WorkloadProperties> &run_workloads);
+bool InsertOnly(const utils::Properties &props);
 
 typedef enum progress_mode {
   no_progress,
@@ -119,6 +181,23 @@ static inline void ProgressFinish(progress_mode pmode,
   ReportProgress(pmode, total_ops, global_op_counter, i % sync_interval, last_printed);
 }
 
+///
+/// Sleeps so that consecutive operations of a thread are interval_ns apart.
+/// Oversleeping is made up for, but a thread that falls more than a
+/// millisecond behind does not burst to catch up.
+///
+static inline void Throttle(uint64_t interval_ns,
+                            chrono::steady_clock::time_point &deadline)
+{
+  deadline += chrono::nanoseconds(interval_ns);
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  if (deadline > now) {
+    this_thread::sleep_until(deadline);
+  } else if (now - deadline > chrono::milliseconds(1)) {
+    deadline = now;
+  }
+}
+
 int DelegateClient(ycsbc::DB *db,
                    ycsbc::CoreWorkload *wl,
                    const uint64_t num_ops,
@@ -126,20 +205,44 @@ int DelegateClient(ycsbc::DB *db,
                    progress_mode pmode,
                    uint64_t total_ops,
                    volatile uint64_t *global_op_counter,
-                   volatile uint64_t *last_printed) {
+                   volatile uint64_t *last_printed,
+                   utils::Histogram *latency) {
   db->Init();
   ycsbc::Client client(*db, *wl);
   uint64_t oks = 0;
 
+  // Operations are issued in batches of batch_size, or one at a time
+  const uint64_t batch_size = wl->batch_size();
   if (is_loading) {
-    for (uint64_t i = 0; i < num_ops; ++i) {
-      oks += client.DoInsert();
-      ProgressUpdate(pmode, total_ops, global_op_counter, i, last_printed);
+    for (uint64_t i = 0; i < num_ops; ) {
+      uint64_t n = min(batch_size, num_ops - i);
+      oks += n > 1 ? client.DoInsertBatch(n) : client.DoInsert();
+      for (uint64_t end = i + n; i < end; ++i) {
+        ProgressUpdate(pmode, total_ops, global_op_counter, i, last_printed);
+      }
     }
   } else {
-    for (uint64_t i = 0; i < num_ops; ++i) {
-      oks += client.DoTransaction();
-      ProgressUpdate(pmode, total_ops, global_op_counter, i, last_printed);
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now();
+    for (uint64_t i = 0; i < num_ops; ) {
+      uint64_t n = min(batch_size, num_ops - i);
+      if (latency) {
+        // Every operation of a batch completes with the batch
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        oks += n > 1 ? client.DoTransactionBatch(n) : client.DoTransaction();
+        uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now() - start).count();
+        for (uint64_t j = 0; j < n; ++j) {
+          latency->Record(ns);
+        }
+      } else {
+        oks += n > 1 ? client.DoTransactionBatch(n) : client.DoTransaction();
+      }
+      for (uint64_t end = i + n; i < end; ++i) {
+        ProgressUpdate(pmode, total_ops, global_op_counter, i, last_printed);
+      }
+      if (wl->op_interval_ns()) {
+        Throttle(wl->op_interval_ns() * n, deadline);
+      }
     }
   }
   ProgressFinish(pmode, total_ops, global_op_counter, num_ops, last_printed);
@@ -147,6 +250,34 @@ int DelegateClient(ycsbc::DB *db,
   return oks;
 }
 
+///
+/// Runs the client threads of a tenant and waits for them, so that the
+/// duration of each tenant is measured on its own.
+///
+void RunTenant(ycsbc::DB *db,
+               Tenant *tenant,
+               utils::Timer<double> *timer,
+               progress_mode pmode,
+               uint64_t total_ops,
+               volatile uint64_t *global_op_counter,
+               volatile uint64_t *last_printed) {
+  vector<future<int>> actual_ops;
+  for (unsigned int i = 0; i < tenant->num_threads; ++i) {
+    uint64_t start_op = (tenant->total_ops * i) / tenant->num_threads;
+    uint64_t end_op = (tenant->total_ops * (i + 1)) / tenant->num_threads;
+    actual_ops.emplace_back(async(launch::async, DelegateClient, db,
+                                  &tenant->wls[i], end_op - start_op, false,
+                                  pmode, total_ops, global_op_counter, last_printed,
+                                  &tenant->latency[i]));
+  }
+  tenant->oks = 0;
+  for (auto &n : actual_ops) {
+    assert(n.valid());
+    tenant->oks += n.get();
+  }
+  tenant->duration = timer->End();
+}
+
 int main(const int argc, const char *argv[]) {
   utils::Properties props;
   WorkloadProperties load_workload;
@@ -166,6 +297,13 @@ int main(const int argc, const char *argv[]) {
   uint64_t sum;
   utils::Timer<double> timer;
 
+  // Databases learn the tables of the Load workload, e.g. to give each one
+  // a column family
+  const string &tables = ycsbc::CoreWorkload::TABLES_PROPERTY;
+  if (props.GetProperty(tables).empty()) {
+    props.SetProperty(tables, load_workload.props.GetProperty(tables));
+  }
+
   ycsbc::DB *db = ycsbc::DBFactory::CreateDB(props, load_workload.preloaded);
   if (!db) {
     cout << "Unknown database name " << props["dbname"] << endl;
@@ -197,7 +335,8 @@ int main(const int argc, const char *argv[]) {
         uint64_t end_op = (record_count * (i + 1)) / num_threads;
         actual_ops.emplace_back(async(launch::async, DelegateClient, db,
                                       &wls[i], end_op - start_op, true,
-                                      pmode, record_count, &load_progress, &last_printed));
+                                      pmode, record_count, &load_progress, &last_printed,
+                                      (utils::Histogram *)NULL));
       }
       assert(actual_ops.size() == num_threads);
       sum = 0;
@@ -213,34 +352,104 @@ int main(const int argc, const char *argv[]) {
     cerr << "# Load throughput (KTPS)" << endl;
     cerr << props["dbname"] << '\t' << load_workload.filename << '\t' << num_threads << '\t';
     cerr << sum / load_duration / 1000 << endl;
+    db->PrintStats(cerr);
   }
 
 
-  // Perform any Run phases
-  for (unsigned int i = 0; i < run_workloads.size(); i++) {
-    auto workload = run_workloads[i];
-    for (unsigned int i = 0; i < num_threads; ++i) {
-      wls[i].InitRunWorkload(workload.props, num_threads, i);
+  // Perform any Run phases, each made of a -W workload and the -C
+  // workloads that follow it
+  for (unsigned int i = 0; i < run_workloads.size(); ) {
+    vector<Tenant> tenants;
+    do {
+      WorkloadProperties &workload = run_workloads[i++];
+      Tenant tenant;
+      tenant.workload = &workload;
+      tenant.num_threads = workload.concurrent ?
+          stoi(workload.props.GetProperty("threadcount", props["threadcount"])) : num_threads;
+      tenant.total_ops = stoi(workload.props[ycsbc::CoreWorkload::OPERATION_COUNT_PROPERTY]);
+      tenant.key_generator = NULL;
+      tenant.trace = NULL;
+      tenant.schedule = NULL;
+      tenant.latency = NULL;
+      tenants.push_back(tenant);
+    } while (i < run_workloads.size() && run_workloads[i].concurrent);
+
+    unsigned int first_thread = 0;
+    total_ops = 0;
+    for (Tenant &tenant : tenants) {
+      utils::Properties &wprops = tenant.workload->props;
+      string trace_file = wprops.GetProperty(ycsbc::CoreWorkload::TRACE_FILE_PROPERTY);
+      if (!trace_file.empty()) {
+        tenant.trace = new ycsbc::TraceReader(trace_file);
+      }
+      if (!wprops.GetProperty(ycsbc::WorkloadSchedule::SCHEDULE_PROPERTY).empty()) {
+        tenant.schedule = new ycsbc::WorkloadSchedule(wprops);
+      }
+
+      // The -W workload goes on with the threads of the Load phase. Other
+      // tenants get their own, and their own key space if they use
+      // another key prefix.
+      tenant.owns_wls = tenant.workload->concurrent;
+      ycsbc::BatchedCounterGenerator *tenant_keys = &key_generator;
+      if (tenant.owns_wls) {
+        tenant.wls = new ycsbc::CoreWorkload[tenant.num_threads];
+        if (wprops.GetProperty(ycsbc::CoreWorkload::KEY_PREFIX_PROPERTY,
+                               ycsbc::CoreWorkload::KEY_PREFIX_DEFAULT) != wls[0].key_prefix()) {
+          if (!InsertOnly(wprops)) {
+            cout << "Workload " << tenant.workload->filename
+                 << " has its own keyprefix and may only insert" << endl;
+            exit(0);
+          }
+          tenant.key_generator = new ycsbc::BatchedCounterGenerator(0, batch_size);
+          tenant_keys = tenant.key_generator;
+        }
+        for (unsigned int j = 0; j < tenant.num_threads; ++j) {
+          tenant.wls[j].InitLoadWorkload(wprops, tenant.num_threads, first_thread + j, tenant_keys);
+        }
+      } else {
+        tenant.wls = wls;
+      }
+      for (unsigned int j = 0; j < tenant.num_threads; ++j) {
+        tenant.wls[j].InitRunWorkload(wprops, tenant.num_threads, first_thread + j,
+                                      tenant.trace, tenant.schedule);
+      }
+      tenant.latency = new utils::Histogram[tenant.num_threads];
+      uint64_t verify_samples = stoull(wprops.GetProperty(
+          ycsbc::CoreWorkload::ZIPFIAN_VERIFY_PROPERTY, ycsbc::CoreWorkload::ZIPFIAN_VERIFY_DEFAULT));
+      if (verify_samples > 0 &&
+          wprops.GetProperty(ycsbc::CoreWorkload::REQUEST_DISTRIBUTION_PROPERTY,
+                             ycsbc::CoreWorkload::REQUEST_DISTRIBUTION_DEFAULT) == "zipfian") {
+        ycsbc::VerifyZipfian(cerr, ycsbc::CoreWorkload::ZipfianKeySpace(wprops, record_count),
+                             ycsbc::CoreWorkload::ZipfianConstant(wprops), verify_samples,
+                             max(thread::hardware_concurrency(), 1u));
+      }
+      first_thread += tenant.num_threads;
+      total_ops += tenant.total_ops;
     }
-    actual_ops.clear();
-    total_ops = stoi(workload.props[ycsbc::CoreWorkload::OPERATION_COUNT_PROPERTY]);
+
     timer.Start();
+    chrono::steady_clock::time_point run_start = chrono::steady_clock::now();
+    for (Tenant &tenant : tenants) {
+      if (tenant.schedule) {
+        tenant.schedule->Start(run_start);
+      }
+      for (unsigned int j = 0; j < tenant.num_threads; ++j) {
+        tenant.wls[j].StartRun(run_start);
+      }
+    }
     {
       cerr << "# Transaction count:\t" << total_ops << endl;
       uint64_t run_progress = 0;
       uint64_t last_printed = 0;
-      for (unsigned int i = 0; i < num_threads; ++i) {
-        uint64_t start_op = (total_ops * i) / num_threads;
-        uint64_t end_op = (total_ops * (i + 1)) / num_threads;
-        actual_ops.emplace_back(async(launch::async, DelegateClient, db,
-                                      &wls[i], end_op - start_op, false,
-                                      pmode, total_ops, &run_progress, &last_printed));
+      vector<future<void>> tenant_runs;
+      for (Tenant &tenant : tenants) {
+        tenant_runs.emplace_back(async(launch::async, RunTenant, db, &tenant, &timer,
+                                       pmode, total_ops, &run_progress, &last_printed));
       }
-      assert(actual_ops.size() == num_threads);
       sum = 0;
-      for (auto &n : actual_ops) {
-        assert(n.valid());
-        sum += n.get();
+      for (unsigned int t = 0; t < tenants.size(); ++t) {
+        tenant_runs[t].get();
+        sum += tenants[t].oks;
       }
       if (pmode != no_progress) {
         cout << "\n";
@@ -248,9 +457,40 @@ int main(const int argc, const char *argv[]) {
     }
     double run_duration = timer.End();
 
+    string filenames;
+    for (Tenant &tenant : tenants) {
+      filenames += (filenames.empty() ? "" : "+") + tenant.workload->filename;
+    }
     cerr << "# Transaction throughput (KTPS)" << endl;
-    cerr << props["dbname"] << '\t' << workload.filename << '\t' << num_threads << '\t';
+    cerr << props["dbname"] << '\t' << filenames << '\t' << first_thread << '\t';
     cerr << sum / run_duration / 1000 << endl;
+    cerr << "# Tenant throughput (KTPS) and latency (us): avg p50 p99 p99.9 max" << endl;
+    for (Tenant &tenant : tenants) {
+      utils::Histogram latency;
+      for (unsigned int j = 0; j < tenant.num_threads; ++j) {
+        latency.Merge(tenant.latency[j]);
+      }
+      cerr << props["dbname"] << '\t' << tenant.workload->filename << '\t'
+           << tenant.num_threads << '\t' << tenant.oks / tenant.duration / 1000 << '\t';
+      latency.PrintSummary(cerr, 1000);
+      cerr << endl;
+      if (tenant.schedule) {
+        tenant.schedule->Report(cerr, props["dbname"] + '\t' + tenant.workload->filename,
+                                tenant.total_ops, tenant.duration);
+      }
+    }
+
+    db->PrintStats(cerr);
+
+    for (Tenant &tenant : tenants) {
+      if (tenant.owns_wls) {
+        delete[] tenant.wls;
+      }
+      delete tenant.key_generator;
+      delete[] tenant.latency;
+      delete tenant.schedule;
+      delete tenant.trace;
+    }
   }
 
   delete db;
@@ -318,6 +558,7 @@ void ParseCommandLine(int argc, const char *argv[],
       props.SetProperty("slaves", argv[argindex]);
       argindex++;
     } else if (strcmp(argv[argindex], "-W") == 0
+               || strcmp(argv[argindex], "-C") == 0
                || strcmp(argv[argindex], "-P") == 0
                || strcmp(argv[argindex], "-L") == 0) {
       WorkloadProperties workload;
@@ -325,6 +566,11 @@ void ParseCommandLine(int argc, const char *argv[],
         workload = load_workload;
       }
       workload.preloaded = strcmp(argv[argindex], "-P") == 0;
+      workload.concurrent = strcmp(argv[argindex], "-C") == 0;
+      if (workload.concurrent && run_workloads.empty()) {
+        UsageMessage(argv[0]);
+        exit(0);
+      }
       argindex++;
       if (argindex >= argc) {
         UsageMessage(argv[0]);
@@ -340,7 +586,7 @@ void ParseCommandLine(int argc, const char *argv[],
       }
       workload.filename.assign(argv[argindex]);
       argindex++;
-      if (strcmp(argv[argindex-2], "-W") == 0) {
+      if (strcmp(argv[argindex-2], "-W") == 0 || strcmp(argv[argindex-2], "-C") == 0) {
         run_workloads.push_back(workload);
         last_workload = &run_workloads[run_workloads.size()-1];
       } else if (saw_load_workload) {
@@ -386,6 +632,41 @@ void ParseCommandLine(int argc, const char *argv[],
     UsageMessage(argv[0]);
     exit(0);
   }
+
+  // Reject workloads the database cannot run, before any client starts
+  vector<WorkloadProperties *> workloads = { &load_workload };
+  for (WorkloadProperties &workload : run_workloads) {
+    workloads.push_back(&workload);
+  }
+  string backend = props["dbname"] == "sharded" ? props.GetProperty("sharded.backend")
+                                                 : props["dbname"];
+  for (WorkloadProperties *workload : workloads) {
+    utils::Properties &wprops = workload->props;
+    // Bounds computed from the trailing record number only hold for keys
+    // numbered in insert order
+    if (props.GetIntProperty("splinterdb.bounded_scans") &&
+        wprops.GetProperty(ycsbc::CoreWorkload::INSERT_ORDER_PROPERTY,
+                           ycsbc::CoreWorkload::INSERT_ORDER_DEFAULT) != "ordered") {
+      cout << "splinterdb.bounded_scans needs insertorder=ordered in " << workload->filename << endl;
+      exit(0);
+    }
+    if (backend == "redis_async") {
+      // Operations only overlap within a batch, and scans need the index
+      // kept by the redis db
+      if (stod(wprops.GetProperty(ycsbc::CoreWorkload::SCAN_PROPORTION_PROPERTY,
+                                  ycsbc::CoreWorkload::SCAN_PROPORTION_DEFAULT)) > 0) {
+        cout << "redis_async does not support scans, used by " << workload->filename
+             << "; use redis with redis.scan_index" << endl;
+        exit(0);
+      }
+      if (ycsbc::CoreWorkload::BatchSize(wprops) == 1 &&
+          props.GetIntProperty("redis.max_inflight") != 1) {
+        cout << "redis_async only keeps a batch in flight: set batchsize > 1 in "
+             << workload->filename << ", or redis.max_inflight=1 for one command at a time" << endl;
+        exit(0);
+      }
+    }
+  }
 }
 
 void UsageMessage(const char *command) {
@@ -399,10 +680,24 @@ void UsageMessage(const char *command) {
   cout << "  -L <file>: Initialize the database with the specified Load workload" << endl;
   cout << "  -P <file>: Indicates that the database has been preloaded with the specified Load workload" << endl;
   cout << "  -W <file>: Perform the Run workload specified in <file>" << endl;
+  cout << "  -C <file>: Perform the Run workload specified in <file> concurrently with the previous one," << endl;
+  cout << "             on <threadcount> threads of its own (default: -threads)" << endl;
   cout << "  -p <prop> <val>: set property <prop> to value <val>" << endl;
   cout << "  -w <prop> <val>: set a property in the previously specified workload" << endl;
   cout << "Exactly one Load workload is allowed, but multiple Run workloads may be given.." << endl;
-  cout << "Run workloads will be executed in the order given on the command line." << endl;
+  cout << "Run workloads will be executed in the order given on the command line," << endl;
+  cout << "each together with the -C workloads that follow it." << endl;
+}
+
+bool InsertOnly(const utils::Properties &props) {
+  typedef ycsbc::CoreWorkload CW;
+  return stod(props.GetProperty(CW::READ_PROPORTION_PROPERTY, CW::READ_PROPORTION_DEFAULT)) == 0
+      && stod(props.GetProperty(CW::UPDATE_PROPORTION_PROPERTY, CW::UPDATE_PROPORTION_DEFAULT)) == 0
+      && stod(props.GetProperty(CW::SCAN_PROPORTION_PROPERTY, CW::SCAN_PROPORTION_DEFAULT)) == 0
+      && stod(props.GetProperty(CW::READMODIFYWRITE_PROPORTION_PROPERTY,
+                                CW::READMODIFYWRITE_PROPORTION_DEFAULT)) == 0
+      && stod(props.GetProperty(CW::TRANSACTION_PROPORTION_PROPERTY,
+                                CW::TRANSACTION_PROPORTION_DEFAULT)) == 0;
 }
 
 inline bool StrStartWith(const char *str, const char *pre) {